@@ -214,6 +214,103 @@ void DwarfFDECache<A>::iterateCacheEntries(void (*func)(
   }
   _LIBUNWIND_LOG_IF_FALSE(_lock.unlock());
 }
+
+#if defined(_LIBUNWIND_IS_BAREMETAL) && defined(__aarch64__)
+#define _LIBUNWIND_PERCPU_FDE_CACHE 1
+
+/// FDE lookup, see __unw_fde_lookup in libunwind.cpp
+enum {
+  kFDELookupScan = 0,   // linear scan of .eh_frame (and the global FDE cache)
+  kFDELookupIndex = 1,  // binary search of .eh_frame_hdr
+  kFDELookupCached = 2, // per-CPU cache, then binary search (default)
+};
+extern "C" int __unw_fde_lookup;
+/// Per-CPU cache of recently used FDEs together with their already parsed
+/// CIE, so unwinding through hot frames skips the .eh_frame_hdr search and
+/// the CIE decoding. Bare metal only: the CPU is identified by
+/// MPIDR_EL1.Aff0 and IRQs are masked while the cache is accessed, so nothing
+/// else can run on this CPU in the meantime and no lock is needed.
+template <typename A>
+class _LIBUNWIND_HIDDEN PerCpuFDECache {
+  typedef typename A::pint_t pint_t;
+  typedef typename CFI_Parser<A>::FDE_Info FDE_Info;
+  typedef typename CFI_Parser<A>::CIE_Info CIE_Info;
+public:
+  static bool find(pint_t pc, FDE_Info *fdeInfo, CIE_Info *cieInfo);
+  static void add(const FDE_Info &fdeInfo, const CIE_Info &cieInfo);
+
+private:
+  enum { kMaxCPUs = 8, kEntries = 8 };
+
+  struct entry {
+    FDE_Info fde;
+    CIE_Info cie;
+  };
+
+  struct cpu_cache {
+    entry entries[kEntries];
+    unsigned next;
+  };
+
+  static cpu_cache _caches[kMaxCPUs];
+
+  static uint64_t irqSave() {
+    uint64_t daif;
+    __asm__ __volatile__("mrs %0, daif\n"
+                         "msr daifset, #2"
+                         : "=r"(daif)
+                         :
+                         : "memory");
+    return daif;
+  }
+
+  static void irqRestore(uint64_t daif) {
+    __asm__ __volatile__("msr daif, %0" : : "r"(daif) : "memory");
+  }
+
+  static unsigned cpu() {
+    uint64_t mpidr;
+    __asm__ __volatile__("mrs %0, mpidr_el1" : "=r"(mpidr));
+    return mpidr & 0xff;
+  }
+};
+
+template <typename A>
+typename PerCpuFDECache<A>::cpu_cache PerCpuFDECache<A>::_caches[kMaxCPUs];
+
+template <typename A>
+bool PerCpuFDECache<A>::find(pint_t pc, FDE_Info *fdeInfo, CIE_Info *cieInfo) {
+  bool found = false;
+  uint64_t daif = irqSave();
+  unsigned c = cpu();
+  if (c < kMaxCPUs) {
+    for (const entry &e : _caches[c].entries) {
+      if (e.fde.pcStart <= pc && pc < e.fde.pcEnd) {
+        *fdeInfo = e.fde;
+        *cieInfo = e.cie;
+        found = true;
+        break;
+      }
+    }
+  }
+  irqRestore(daif);
+  return found;
+}
+
+template <typename A>
+void PerCpuFDECache<A>::add(const FDE_Info &fdeInfo, const CIE_Info &cieInfo) {
+  uint64_t daif = irqSave();
+  unsigned c = cpu();
+  if (c < kMaxCPUs) {
+    cpu_cache &cache = _caches[c];
+    entry &e = cache.entries[cache.next];
+    e.fde = fdeInfo;
+    e.cie = cieInfo;
+    cache.next = (cache.next + 1) % kEntries;
+  }
+  irqRestore(daif);
+}
+#endif // defined(_LIBUNWIND_IS_BAREMETAL) && defined(__aarch64__)
 #endif // defined(_LIBUNWIND_SUPPORT_DWARF_UNWIND)
 
 
@@ -1489,8 +1586,21 @@ bool UnwindCursor<A, R>::getInfoFromDwarfSection(pint_t pc,
                                     sects.dwarf_section + fdeSectionOffsetHint,
                                     &fdeInfo, &cieInfo);
   }
+#if defined(_LIBUNWIND_PERCPU_FDE_CACHE)
+  const int lookup = __unw_fde_lookup;
+  if (!foundFDE && lookup >= kFDELookupCached &&
+      PerCpuFDECache<A>::find(pc, &fdeInfo, &cieInfo)) {
+    foundFDE = true;
+    foundInCache = true;
+  }
+#endif
 #if defined(_LIBUNWIND_SUPPORT_DWARF_INDEX)
-  if (!foundFDE && (sects.dwarf_index_section != 0)) {
+  bool useIndex = sects.dwarf_index_section != 0;
+#if defined(_LIBUNWIND_PERCPU_FDE_CACHE)
+  // without the index it behaves as if there was no .eh_frame_hdr
+  useIndex = useIndex && lookup >= kFDELookupIndex;
+#endif
+  if (!foundFDE && useIndex) {
     foundFDE = EHHeaderParser<A>::findFDE(
         _addressSpace, pc, sects.dwarf_index_section,
         (uint32_t)sects.dwarf_index_section_length, &fdeInfo, &cieInfo);
@@ -1532,8 +1642,12 @@ bool UnwindCursor<A, R>::getInfoFromDwarfSection(pint_t pc,
       // Add to cache (to make next lookup faster) if we had no hint
       // and there was no index.
       if (!foundInCache && (fdeSectionOffsetHint == 0)) {
+  #if defined(_LIBUNWIND_PERCPU_FDE_CACHE)
+        if (lookup >= kFDELookupCached)
+          PerCpuFDECache<A>::add(fdeInfo, cieInfo);
+  #endif
   #if defined(_LIBUNWIND_SUPPORT_DWARF_INDEX)
-        if (sects.dwarf_index_section == 0)
+        if (!useIndex)
   #endif
         DwarfFDECache<A>::add(sects.dso_base, fdeInfo.pcStart, fdeInfo.pcEnd,
                               fdeInfo.fdeStart);
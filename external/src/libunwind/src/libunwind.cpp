@@ -253,6 +253,12 @@ _LIBUNWIND_HIDDEN void __unw_iterate_dwarf_unwind_cache(void (*func)(
 _LIBUNWIND_WEAK_ALIAS(__unw_iterate_dwarf_unwind_cache,
                       unw_iterate_dwarf_unwind_cache)
 
+#if defined(_LIBUNWIND_PERCPU_FDE_CACHE)
+/// SPI: FDE lookup used by the unwinder (kFDELookup*), it can be changed at
+/// runtime to compare them, e.g. the except.bench test
+_LIBUNWIND_HIDDEN int __unw_fde_lookup = kFDELookupCached;
+#endif
+
 /// IPI: for __register_frame()
 void __unw_add_dynamic_fde(unw_word_t fde) {
   CFI_Parser<LocalAddressSpace>::FDE_Info fdeInfo;
@@ -5,6 +5,9 @@ AARCH64_MARCH ?= armv8.5a
 GLOBAL_CPPFLAGS += -DAARCH64 -target aarch64-unknown-none
 GLOBAL_CFLAGS += -target aarch64-unknown-none
 
+# sorted FDE table used by libunwind to binary search the frame of a given pc
+GLOBAL_LDFLAGS += --eh-frame-hdr
+
 ifeq ($(CONFIG_AARCH64_MTE), y)
 GLOBAL_CPPFLAGS += -DCONFIG_AARCH64_MTE
 GLOBAL_CFLAGS += -march=$(AARCH64_MARCH)+memtag
@@ -0,0 +1,32 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Command to print boot phases timestamps
+ */
+
+#include <app/shell.h>
+#include <errcodes.h>
+
+import lib.boottime;
+import lib.fmt;
+
+using lib::fmt::println;
+
+void cmd_boottime_usage() {
+    println("boottime");
+}
+
+static int cmd_boottime(int argc, char const*[]) {
+    if (argc > 1)
+        return ERR_INVALID_ARGS;
+
+    lib::boottime::dump();
+    return 0;
+}
+
+shell_declare_static_cmd(boottime, "print boot phases timestamps (us)", cmd_boottime,
+                         cmd_boottime_usage);
@@ -0,0 +1,40 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Command to print the log records (lib::log) of all cpus
+ */
+
+#include <app/shell.h>
+#include <errcodes.h>
+#include <string.h>
+
+import lib.fmt;
+import lib.log;
+
+using lib::fmt::println;
+
+void cmd_dmesg_usage() {
+    println("dmesg [-c]");
+    println("  -c  clear the records once printed");
+}
+
+static int cmd_dmesg(int argc, char const* argv[]) {
+    bool clear = false;
+
+    if (argc > 2)
+        return ERR_INVALID_ARGS;
+    if (argc == 2) {
+        if (strcmp(argv[1], "-c"))
+            return ERR_INVALID_ARGS;
+        clear = true;
+    }
+
+    lib::log::dump(clear);
+    return 0;
+}
+
+shell_declare_static_cmd(dmesg, "print log records", cmd_dmesg, cmd_dmesg_usage);
@@ -10,6 +10,7 @@
 
 #include <app/shell.h>
 #include <errcodes.h>
+#include <stdlib.h>
 #include <string.h>
 
 import lib.fmt;
@@ -24,8 +25,110 @@ using std::string;
 void cmd_heap_usage() {
     println("heap alloc <size> [alignment]");
     println("heap free <addr>");
+    println("heap stats [reset]");
+    println("heap dump [region]");
+    println("heap regions");
+#ifdef CONFIG_HEAP_TRACKER
+    println("heap track <on|off>");
+    println("heap sites [count]");
+    println("heap leaks [mark]");
+    println("Note: use llvm-addr2line -e sc.elf <site> to translate sites to source lines");
+#endif
 }
 
+static void heap_stats() {
+    auto s = lib::heap::stats();
+
+    println("total          {}", s.total);
+    println("used           {}", s.used);
+    println("peak           {}", s.peak);
+    println("allocs         {}", s.alloc_count);
+    println("frees          {}", s.free_count);
+    println("failed         {}", s.fail_count);
+    println("free           {}", s.free_bytes);
+    println("free blocks    {}", s.free_blocks);
+    println("largest free   {}", s.largest_free);
+    println("fragmentation  {}%", lib::allocator::stats_fragmentation(s));
+
+    using lib::allocator::STATS_HIST_BUCKETS;
+    using lib::allocator::STATS_HIST_SHIFT;
+
+    println("free block sizes:");
+    for (unsigned i = 0; i < STATS_HIST_BUCKETS; ++i) {
+        if (!s.hist[i])
+            continue;
+        if (i == STATS_HIST_BUCKETS - 1)
+            println("  >= {:<10} {}", 1UL << (STATS_HIST_SHIFT + i - 1), s.hist[i]);
+        else
+            println("  <  {:<10} {}", 1UL << (STATS_HIST_SHIFT + i), s.hist[i]);
+    }
+}
+
+static void heap_regions() {
+    using namespace lib::heap;
+
+    println("{:<3}  {:<12}  {:<18}  {:<18}  {:>5}  {:>3}  {:>10}  {:>10}", "id", "name", "start",
+            "end", "flags", "cpu", "total", "used");
+    for (size_t i = 0; i < num_regions(); ++i) {
+        auto r = get_region(i);
+        auto s = stats(i);
+        println("{:<3}  {:<12}  {:#018x}  {:#018x}  {:>5}  {:>3}  {:>10}  {:>10}", i, r.name,
+                r.start, r.end, r.flags, r.cpu, s.total, s.used);
+    }
+}
+
+#ifdef CONFIG_HEAP_TRACKER
+
+namespace tracker = lib::heap::tracker;
+
+static tracker::site_info sites[tracker::max_sites()];
+static tracker::leak_info leaks[tracker::max_sites()];
+
+static void heap_tracker_info() {
+    auto info = tracker::get_info();
+    println("tracker {}, tracked {}, dropped {}, sites {}", info.enabled ? "on" : "off",
+            info.tracked, info.dropped, info.sites);
+}
+
+static void heap_sites(size_t max) {
+    size_t n = tracker::get_sites(sites, tracker::max_sites());
+
+    // sort by live bytes, biggest first
+    qsort(sites, n, sizeof sites[0], [](void const* a, void const* b) {
+        auto sa = static_cast<tracker::site_info const*>(a);
+        auto sb = static_cast<tracker::site_info const*>(b);
+        return sa->live_bytes < sb->live_bytes ? 1 : sa->live_bytes > sb->live_bytes ? -1 : 0;
+    });
+
+    heap_tracker_info();
+    println("{:<18}  {:>10}  {:>10}  {:>10}", "site", "bytes", "count", "total");
+    for (size_t i = 0; i < n && i < max; ++i) {
+        auto& s = sites[i];
+        println("{:#018x}  {:>10}  {:>10}  {:>10}", s.site, s.live_bytes, s.live_count,
+                s.total_count);
+    }
+}
+
+static void heap_leaks() {
+    long n = tracker::get_leaks(leaks, tracker::max_sites());
+    if (n < 0) {
+        println("no mark, use 'heap leaks mark' first");
+        return;
+    }
+
+    qsort(leaks, n, sizeof leaks[0], [](void const* a, void const* b) {
+        auto la = static_cast<tracker::leak_info const*>(a);
+        auto lb = static_cast<tracker::leak_info const*>(b);
+        return la->bytes < lb->bytes ? 1 : la->bytes > lb->bytes ? -1 : 0;
+    });
+
+    println("{:<18}  {:>10}  {:>10}", "site", "+bytes", "+count");
+    for (long i = 0; i < n; ++i)
+        println("{:#018x}  {:>10}  {:>10}", leaks[i].site, leaks[i].bytes, leaks[i].count);
+}
+
+#endif
+
 static int cmd_heap(int argc, char const* argv[]) {
     if (argc < 2) {
         cmd_heap_usage();
@@ -48,6 +151,26 @@ static int cmd_heap(int argc, char const* argv[]) {
     } else if (argc == 3 && cmd == "free") {
         auto ptr = (void*)strtoul(argv[2], NULL, 16);
         free(ptr);
+    } else if (argc == 2 && cmd == "stats") {
+        heap_stats();
+    } else if (argc == 3 && cmd == "stats" && string("reset") == argv[2]) {
+        lib::heap::reset_peak();
+    } else if (argc >= 2 && cmd == "dump") {
+        lib::heap::dump(argc == 3 ? strtoul(argv[2], NULL, 0) : 0);
+    } else if (argc == 2 && cmd == "regions") {
+        heap_regions();
+#ifdef CONFIG_HEAP_TRACKER
+    } else if (argc == 3 && cmd == "track") {
+        tracker::enable(string("on") == argv[2]);
+        heap_tracker_info();
+    } else if (argc >= 2 && cmd == "sites") {
+        size_t max = argc == 3 ? strtoul(argv[2], NULL, 0) : 16;
+        heap_sites(max);
+    } else if (argc == 3 && cmd == "leaks" && string("mark") == argv[2]) {
+        tracker::mark();
+    } else if (argc == 2 && cmd == "leaks") {
+        heap_leaks();
+#endif
     } else {
         cmd_heap_usage();
     }
@@ -13,12 +13,16 @@
 #include <string.h>
 
 import lib.fmt;
-import std.string;
-import std.vector;
+import std.fixed_string;
+import std.static_vector;
 
 using lib::fmt::println;
-using std::string;
-using std::vector;
+using std::fixed_string;
+using std::static_vector;
+
+// commands are rebuilt from the shell arguments, so they can't be longer than a shell line
+constexpr size_t MAX_CMDS_SIZE = 128;
+constexpr size_t MAX_CMDS = 16;
 
 static void cmd_loop_usage() {
     println("loop <range> <command>");
@@ -33,22 +37,32 @@ static void cmd_loop_usage() {
     // 8
 }
 
-static vector<string> split_by(string const& str, char delim) {
-    vector<string> strings;
-
-    string tmp = "";
-    for (auto c : str) {
+//
+// split_by - Split @str in place at every @delim
+//
+// Delimiters are replaced by null terminators, the returned pointers point into @str. Empty
+// strings are skipped
+//
+template <size_t N>
+static static_vector<char const*, MAX_CMDS> split_by(fixed_string<N>& str, char delim) {
+    static_vector<char const*, MAX_CMDS> strings;
+
+    char const* start = nullptr;
+    for (auto& c : str) {
         if (c != delim) {
-            tmp += c;
-        } else if (tmp != "") {
-            strings.push_back(tmp);
-            tmp = "";
+            if (!start)
+                start = &c;
+        } else {
+            c = 0;
+            if (start && !strings.push_back(start))
+                println("loop: too many commands, max {}", MAX_CMDS);
+            start = nullptr;
         }
     }
 
     // push remaining
-    if (tmp != "")
-        strings.push_back(tmp);
+    if (start && !strings.push_back(start))
+        println("loop: too many commands, max {}", MAX_CMDS);
 
     return strings;
 }
@@ -61,7 +75,8 @@ static int cmd_loop(int argc, char const* argv[]) {
 
     size_t num = strtoul(argv[1], nullptr, 0);
 
-    string cmd_str = "";
+    // command parsing is short lived, keep it out of the global heap
+    fixed_string<MAX_CMDS_SIZE> cmd_str;
 
     for (int i = 2; i < argc; ++i) {
         if (i != 2)
@@ -71,8 +86,8 @@ static int cmd_loop(int argc, char const* argv[]) {
 
     auto cmds = split_by(cmd_str, ';');
     for (size_t i = 0; i != num; ++i)
-        for (auto& cmd : cmds)
-            shell_exec_cmd(cmd.c_str());
+        for (auto cmd : cmds)
+            shell_exec_cmd(cmd);
 
     return 0;
 }
@@ -16,6 +16,7 @@ import core.thread;
 import lib.fmt;
 import std.string;
 import arch.aarch64.mte;
+import lib.allocator.simple;
 
 using lib::fmt::println;
 using std::string;
@@ -25,6 +26,13 @@ void cmd_mte_usage() {
     println("mte tag <addr> [size]");
     println("mte load <addr>");
     println("mte teststack");
+    println("mte sample [rate] [max_size]");
+}
+
+static void mte_sampling() {
+    auto s = lib::allocator::mte::get_sampling();
+    println("rate 1/{}, max size {}, tagged {}, untagged {}", s.rate, s.max_size, s.tagged,
+            s.untagged);
 }
 
 static int cmd_mte(int argc, char const* argv[]) {
@@ -64,6 +72,13 @@ static int cmd_mte(int argc, char const* argv[]) {
         int a = 10;
         int b = 15;
         println("a addr {:p} b addr {:p} a*b={}", &a, &b, a * b);
+    } else if (argc == 2 && cmd == "sample") {
+        mte_sampling();
+    } else if (argc >= 3 && cmd == "sample") {
+        unsigned rate = strtoul(argv[2], NULL, 0);
+        size_t max_size = argc >= 4 ? strtoul(argv[3], NULL, 0) : 0;
+        lib::allocator::mte::set_sampling(rate, max_size);
+        mte_sampling();
     } else {
         cmd_mte_usage();
     }
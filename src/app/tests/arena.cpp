@@ -0,0 +1,105 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <test.h>
+
+import lib.arena;
+import lib.heap;
+import lib.pool;
+
+using lib::arena;
+using lib::arena_string;
+using lib::arena_vector;
+
+TEST(arena, alloc) {
+    alignas(16) char mem[128];
+    arena ar(mem, sizeof mem);
+
+    auto p = static_cast<char*>(ar.alloc(10, 1));
+    auto q = static_cast<char*>(ar.alloc(8, 8));
+    EXPECT(p == mem);
+    EXPECT(q == mem + 16);
+    EXPECT(ar.used() == 24);
+
+    // only the last allocation can be given back
+    ar.free(p, 10);
+    EXPECT(ar.used() == 24);
+    ar.free(q, 8);
+    EXPECT(ar.alloc(8, 8) == q);
+
+    ar.reset();
+    EXPECT(ar.used() == 0);
+    EXPECT(ar.alloc(1, 1) == mem);
+
+    // zero bytes, also on an arena without any memory yet
+    EXPECT(ar.alloc(0) != nullptr);
+    arena empty;
+    EXPECT(empty.alloc(0) != nullptr);
+    EXPECT(empty.used() == 0);
+}
+
+TEST(arena, grow) {
+    char mem[64];
+    arena ar(mem, sizeof mem);
+
+    // buffer is exhausted, it goes to the heap
+    void* p = ar.alloc(1000);
+    ASSERT(p);
+    EXPECT(p < mem || p >= mem + sizeof mem);
+
+    auto used = lib::heap::stats().used;
+    ar.reset();
+    EXPECT(lib::heap::stats().used < used);
+    EXPECT(ar.peak() >= 1000);
+}
+
+TEST(arena, containers) {
+    char mem[2048];
+    arena ar(mem, sizeof mem);
+    auto allocs = lib::heap::stats().alloc_count;
+
+    {
+        arena_vector<arena_string> vec(ar);
+        for (int i = 0; i < 8; ++i)
+            vec.push_back(arena_string("a string longer than 15 chars", ar));
+
+        EXPECT(vec.size() == 8);
+        EXPECT(vec[7] == "a string longer than 15 chars");
+
+        arena_string s("", ar);
+        lib::fmt::sprint(s, "{} {:#x}", "hex", 255);
+        EXPECT(s == "hex 0xff");
+    }
+
+    // everything fits in the buffer
+    EXPECT(lib::heap::stats().alloc_count == allocs);
+}
+
+TEST(pool, create) {
+    struct obj {
+        int a;
+        int b;
+    };
+    lib::pool<obj, 4> p;
+    EXPECT(p.available() == 4);
+
+    obj* o[4];
+    for (int i = 0; i < 4; ++i) {
+        o[i] = p.create(i, i * 2);
+        ASSERT(o[i]);
+        EXPECT(p.owns(o[i]));
+        EXPECT(o[i]->b == i * 2);
+    }
+
+    EXPECT(p.available() == 0);
+    EXPECT(p.create(0, 0) == nullptr);
+
+    p.destroy(o[2]);
+    EXPECT(p.available() == 1);
+    EXPECT(p.create(5, 5) == o[2]);
+}
@@ -0,0 +1,29 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <test.h>
+
+import lib.cache;
+
+TEST(cache, ranges) {
+    size_t line = lib::cache::dcache_line();
+    EXPECT(line >= 4 && !(line & (line - 1)));
+
+    alignas(256) static uint8_t buf[1024];
+    for (size_t i = 0; i < sizeof(buf); ++i)
+        buf[i] = i;
+    lib::cache::clean(buf, sizeof(buf));
+    lib::cache::clean_invalidate(buf, sizeof(buf));
+    EXPECT(buf[0] == 0 && buf[sizeof(buf) - 1] == 0xff);
+
+    // lines partially in the range are written back, bytes around it are kept
+    buf[0] = 0xaa;
+    buf[301] = 0x55;
+    lib::cache::invalidate(buf + 1, 300);
+    EXPECT(buf[0] == 0xaa && buf[301] == 0x55);
+}
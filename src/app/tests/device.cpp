@@ -0,0 +1,49 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+#include <test.h>
+
+import device;
+import std.string;
+
+using device::class_type;
+using device::manager;
+
+// PWM has no driver on the test boards, the registry is all ours for that type
+struct fake_pwm : device::device {
+    constexpr static class_type dev_type = class_type::PWM;
+    class_type type() const override { return dev_type; }
+
+    fake_pwm(std::string const& name) : device(name) {}
+};
+
+// keeps @dev registered for the scope, a failing EXPECT() must not leave stack devices behind
+struct registered {
+    registered(device::device* dev) : dev(dev) { manager::register_device(dev); }
+    ~registered() { manager::unregister_device(dev); }
+
+    device::device* dev;
+};
+
+TEST(device, registry) {
+    fake_pwm p0("pwm0"), p1("pwm1");
+    registered r0(&p0), r1(&p1);
+
+    EXPECT(manager::find<fake_pwm>() == &p0);
+    EXPECT(manager::find<fake_pwm>("pwm1") == &p1);
+    EXPECT(manager::find<fake_pwm>("pwm2") == nullptr);
+    EXPECT(manager::find_all<fake_pwm>().size() == 2);
+
+    // handles look up the device again once it is unregistered
+    device::handle<fake_pwm> h("pwm0");
+    EXPECT(h.get() == &p0);
+    manager::unregister_device(&p0);
+    EXPECT(h.get() == nullptr);
+    EXPECT(manager::find<fake_pwm>() == &p1);
+
+    manager::unregister_device(&p1);
+    EXPECT(manager::find<fake_pwm>() == nullptr);
+}
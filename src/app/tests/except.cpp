@@ -3,10 +3,15 @@
  * Copyright (c) 2021 Fernando Lugo <lugo.fernando@gmail.com>
  */
 
+#include <errcodes.h>
+#include <stdint.h>
+#include <string.h>
 #include <test.h>
 
 import lib.exception;
 import lib.fmt;
+import lib.heap;
+import lib.timestamp;
 
 using lib::exception;
 
@@ -41,12 +46,12 @@ TEST(except, throw) {
     // throw a lib exception
     try {
         throw exception("real exception");
-    } catch (exception& e) { EXPECT(e.msg() == "real exception"); }
+    } catch (exception& e) { EXPECT(!strcmp(e.msg(), "real exception")); }
 
     // throw and catch all
     try {
         throw 12.5;
-    } catch (exception& e) { EXPECT(e.msg() == "we should not be here"); } catch (...) {
+    } catch (exception& e) { EXPECT(!strcmp(e.msg(), "we should not be here")); } catch (...) {
         EXPECT(true);
     }
 
@@ -60,7 +65,7 @@ TEST(except, throw) {
             throw exception("throw new one");
         }
     } catch (exception& e) {
-        EXPECT(e.msg() == "throw new one");
+        EXPECT(!strcmp(e.msg(), "throw new one"));
     } catch (...) {
         EXPECT(false);
     }*/
@@ -101,3 +106,81 @@ TEST(except, cleanup) {
         EXPECT(false);
     } catch (exception& e) { EXPECT(foo::counter == 0); }
 }
+
+TEST(except, no_heap) {
+    auto s0 = lib::heap::stats();
+
+    // exception memory and short messages must not come from the heap, and thrown objects must be
+    // released when the handler ends
+    for (int i = 0; i < 100; ++i) {
+        try {
+            throw exception("event timeout", ERR_TIMED_OUT);
+        } catch (exception& e) { EXPECT(e.error() == ERR_TIMED_OUT); }
+    }
+
+    auto s1 = lib::heap::stats();
+    EXPECT(s1.alloc_count == s0.alloc_count);
+    EXPECT(s1.used == s0.used);
+}
+
+TEST(except, long_msg) {
+    char const* msg = "a message that does not fit in the exception inline buffer";
+    try {
+        throw exception(msg);
+    } catch (exception& e) { EXPECT(!strcmp(e.msg(), msg)); }
+}
+
+constexpr int BENCH_DEPTH = 4;
+
+[[gnu::noinline]] static void throw_from(int depth) {
+    if (!depth)
+        throw exception("bench");
+    throw_from(depth - 1);
+    // avoid tail call, each level needs its own frame to unwind
+    asm volatile("" ::: "memory");
+}
+
+#ifdef __aarch64__
+// FDE lookup of libunwind: 0 linear scan of .eh_frame, 1 .eh_frame_hdr, 2 per-cpu cache (default)
+extern "C" int __unw_fde_lookup;
+#endif
+
+// average ns of a throw/catch through BENCH_DEPTH + 1 frames
+static uint64_t throw_ns() {
+    constexpr int LOOPS = 1000;
+
+    // warm up, so every mode starts with its caches filled
+    try {
+        throw_from(BENCH_DEPTH);
+    } catch (exception&) {}
+
+    auto start = lib::timestamp::ticks();
+    for (int i = 0; i < LOOPS; ++i) {
+        try {
+            throw_from(BENCH_DEPTH);
+        } catch (exception&) {}
+    }
+    return lib::timestamp::ticks_to_ns(lib::timestamp::ticks() - start) / LOOPS;
+}
+
+TEST(except, bench) {
+#ifdef __aarch64__
+    // the old lookup (linear scan) next to the new ones
+    constexpr char const* names[] = {"eh_frame scan", "eh_frame_hdr", "eh_frame_hdr + cpu cache"};
+    uint64_t ns[3];
+    int saved = __unw_fde_lookup;
+    for (int mode = 0; mode != 3; ++mode) {
+        __unw_fde_lookup = mode;
+        ns[mode] = throw_ns();
+    }
+    __unw_fde_lookup = saved;
+
+    for (int mode = 0; mode != 3; ++mode) {
+        uint64_t d = ns[mode] ?: 1;
+        lib::fmt::println("throw/catch through {} frames, {}: {} ns ({}.{:02}x)", BENCH_DEPTH + 1,
+                          names[mode], ns[mode], ns[0] / d, ns[0] * 100 / d % 100);
+    }
+#else
+    lib::fmt::println("throw/catch through {} frames: {} ns", BENCH_DEPTH + 1, throw_ns());
+#endif
+}
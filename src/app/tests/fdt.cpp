@@ -0,0 +1,114 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <test.h>
+
+import lib.fdt;
+
+using lib::fdt;
+
+// blob for:
+//
+// / {
+//     #address-cells = <2>;
+//     #size-cells = <2>;
+//     memory@40000000 { device_type = "memory"; reg = <0 0x40000000 1 0>; };
+//     cpus {
+//         #address-cells = <1>;
+//         #size-cells = <0>;
+//         cpu@0 { device_type = "cpu"; reg = <0>; };
+//         cpu@1 { device_type = "cpu"; reg = <1>; };
+//     };
+//     uart@9000000 { compatible = "arm,pl011", "arm,primecell"; reg = <0 0x9000000 0 0x1000>; };
+// };
+alignas(8) static uint8_t const dtb[] = {
+    0xd0, 0x0d, 0xfe, 0xed, 0x00, 0x00, 0x01, 0xce, 0x00, 0x00, 0x00, 0x38,
+    0x00, 0x00, 0x01, 0x98, 0x00, 0x00, 0x00, 0x28, 0x00, 0x00, 0x00, 0x11,
+    0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x36,
+    0x00, 0x00, 0x01, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x01, 0x6d, 0x65, 0x6d, 0x6f, 0x72, 0x79, 0x40, 0x34,
+    0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x1b, 0x6d, 0x65, 0x6d, 0x6f,
+    0x72, 0x79, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x10,
+    0x00, 0x00, 0x00, 0x27, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x01, 0x63, 0x70, 0x75, 0x73, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04,
+    0x00, 0x00, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+    0x63, 0x70, 0x75, 0x40, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x1b, 0x63, 0x70, 0x75, 0x00,
+    0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x27,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01,
+    0x63, 0x70, 0x75, 0x40, 0x31, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x1b, 0x63, 0x70, 0x75, 0x00,
+    0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x27,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02,
+    0x00, 0x00, 0x00, 0x01, 0x75, 0x61, 0x72, 0x74, 0x40, 0x39, 0x30, 0x30,
+    0x30, 0x30, 0x30, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x2b, 0x61, 0x72, 0x6d, 0x2c,
+    0x70, 0x6c, 0x30, 0x31, 0x31, 0x00, 0x61, 0x72, 0x6d, 0x2c, 0x70, 0x72,
+    0x69, 0x6d, 0x65, 0x63, 0x65, 0x6c, 0x6c, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x27, 0x00, 0x00, 0x00, 0x00,
+    0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+    0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x09,
+    0x23, 0x61, 0x64, 0x64, 0x72, 0x65, 0x73, 0x73, 0x2d, 0x63, 0x65, 0x6c,
+    0x6c, 0x73, 0x00, 0x23, 0x73, 0x69, 0x7a, 0x65, 0x2d, 0x63, 0x65, 0x6c,
+    0x6c, 0x73, 0x00, 0x64, 0x65, 0x76, 0x69, 0x63, 0x65, 0x5f, 0x74, 0x79,
+    0x70, 0x65, 0x00, 0x72, 0x65, 0x67, 0x00, 0x63, 0x6f, 0x6d, 0x70, 0x61,
+    0x74, 0x69, 0x62, 0x6c, 0x65, 0x00,
+};
+
+TEST(fdt, lookup) {
+    fdt dt(dtb);
+    EXPECT(dt.valid() && dt.size() == sizeof(dtb));
+
+    fdt::node n;
+    uint64_t addr, size;
+    EXPECT(dt.find("/memory", n));
+    EXPECT(dt.reg(n, 0, addr, size) && addr == 0x4000'0000 && size == 0x1'0000'0000);
+    EXPECT(!dt.reg(n, 1, addr, size));
+
+    // cpus node changes the cells of its children
+    EXPECT(dt.find("/cpus/cpu@1", n) && n.addr_cells == 1 && n.size_cells == 0);
+    EXPECT(dt.reg(n, 0, addr, size) && addr == 1);
+    EXPECT(!dt.find("/cpus/cpu@2", n));
+
+    fdt::node cpus;
+    unsigned count = 0;
+    EXPECT(dt.find("/cpus", cpus));
+    dt.for_each_child(cpus, [&](fdt::node const& c) {
+        count += !strcmp(dt.get(c, "device_type").str(), "cpu");
+        return false;
+    });
+    EXPECT(count == 2);
+
+    EXPECT(dt.find_compatible("arm,primecell", n) && !strcmp(n.name, "uart@9000000"));
+    EXPECT(dt.reg(n, 0, addr, size) && addr == 0x900'0000 && size == 0x1000);
+    EXPECT(!dt.find_compatible("arm,gic-400", n));
+}
+
+TEST(fdt, corrupted) {
+    alignas(8) uint8_t blob[sizeof(dtb)];
+    memcpy(blob, dtb, sizeof(dtb));
+
+    // bad magic
+    blob[0] = 0;
+    EXPECT(!fdt(blob).valid());
+
+    // property length past the end of the struct block
+    memcpy(blob, dtb, sizeof(dtb));
+    blob[0x44] = 0xff;
+    fdt dt(blob);
+    fdt::node n;
+    EXPECT(dt.valid() && !dt.find("/memory", n));
+}
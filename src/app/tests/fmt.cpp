@@ -0,0 +1,48 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+#include <test.h>
+
+import lib.fmt;
+import lib.heap;
+
+using lib::fmt::sprint;
+
+extern "C" void* fmt_get_line_buffer();
+
+TEST(fmt, modifiers) {
+    EXPECT(sprint("{} {:#x} {:X} {:o}", -42, 255, 0xabcU, 8) == "-42 0xff ABC 10");
+    EXPECT(sprint("{:08d}|{:<4}|{:>4}|", -42, "ab", "cd") == "-0000042|ab  |  cd|");
+    EXPECT(sprint("{:c}{:c}", 'o', 107) == "ok");
+    EXPECT(sprint("{:p}", reinterpret_cast<void*>(0x1000)) == "0x1000");
+
+    char const* null_str = nullptr;
+    EXPECT(sprint("{}", null_str) == "(nullptr)");
+}
+
+TEST(fmt, escape) {
+    EXPECT(sprint("{{}}") == "{}");
+    EXPECT(sprint("{{{}}}", 1) == "{1}");
+}
+
+TEST(fmt, no_heap) {
+    auto s0 = lib::heap::stats();
+
+    // the result fits in the string inline buffer, nothing else may allocate
+    auto s = sprint("{:#x} {:>4}", 10, "ab");
+
+    EXPECT(lib::heap::stats().alloc_count == s0.alloc_count);
+    EXPECT(s == "0xa   ab");
+}
+
+TEST(fmt, line_buffer) {
+    auto lb = static_cast<lib::fmt::line_buffer*>(fmt_get_line_buffer());
+    ASSERT(lb);
+
+    // the buffer is flushed and released at the end of every print
+    lib::fmt::print("{}", "");
+    EXPECT(!lb->busy && lb->len == 0);
+}
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+#include <stdint.h>
+#include <test.h>
+
+import lib.heap;
+
+TEST(heap, stats) {
+    auto s0 = lib::heap::stats();
+    EXPECT(s0.used <= s0.peak);
+    EXPECT(s0.free_bytes + s0.used <= s0.total);
+
+    void* p = lib::heap::alloc(1000);
+    ASSERT(p);
+
+    auto s1 = lib::heap::stats();
+    EXPECT(s1.alloc_count == s0.alloc_count + 1);
+    EXPECT(s1.used >= s0.used + 1000);
+    EXPECT(s1.peak >= s1.used);
+
+    lib::heap::free(p);
+
+    auto s2 = lib::heap::stats();
+    EXPECT(s2.free_count == s1.free_count + 1);
+    EXPECT(s2.used == s0.used);
+    EXPECT(s2.largest_free <= s2.free_bytes);
+}
+
+TEST(heap, hist_bucket) {
+    using lib::allocator::stats_hist_bucket;
+
+    EXPECT(stats_hist_bucket(0) == 0);
+    EXPECT(stats_hist_bucket(31) == 0);
+    EXPECT(stats_hist_bucket(32) == 1);
+    EXPECT(stats_hist_bucket(64) == 2);
+    EXPECT(stats_hist_bucket(~0UL) == lib::allocator::STATS_HIST_BUCKETS - 1);
+}
+
+TEST(heap, hint) {
+    using lib::heap::hint;
+
+    ASSERT(lib::heap::num_regions() >= 1);
+    auto r = lib::heap::get_region(0);
+    EXPECT(r.start < r.end);
+
+    // with no matching region the allocation comes from the main heap
+    auto s0 = lib::heap::stats();
+    void* p = lib::heap::alloc(256, 16, hint::DMA);
+    ASSERT(p);
+    EXPECT(!(reinterpret_cast<uintptr_t>(p) & 15));
+
+    void* q = lib::heap::alloc(256, 8, hint::CORE_LOCAL);
+    ASSERT(q);
+
+    lib::heap::free(p);
+    lib::heap::free(q);
+    EXPECT(lib::heap::stats().used == s0.used);
+}
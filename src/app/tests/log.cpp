@@ -0,0 +1,87 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <test.h>
+
+import lib.log;
+import lib.cpu;
+
+using lib::log::record;
+using lib::log::RING_SIZE;
+
+static constexpr char const* TEST_FMT = "log test {}";
+static constexpr char const* FILL_FMT = "log fill {}";
+
+static bool is(record const& rec, char const* fmt) { return !strcmp(rec.fmt, fmt); }
+
+// records logged by the test, irqs stay off meanwhile so every record goes to the ring of this cpu
+// and nothing else writes to it. EXPECT() throws, so they are checked once irqs are back on
+TEST(log, ring) {
+    auto flags = lib::cpu::save_and_disable_irq();
+    lib::log::for_each_record([](unsigned, record const&) {}, true);
+
+    // the ring keeps the newest RING_SIZE - 1 records
+    for (unsigned i = 0; i != RING_SIZE + 5; ++i)
+        lib::log::log("log test {}", i);
+
+    unsigned n = 0;
+    uint64_t last = 0;
+    bool ordered = true;
+    lib::log::for_each_record([&](unsigned, record const& rec) {
+        if (!is(rec, TEST_FMT))
+            return;
+        ordered = ordered && rec.args[0] == n + 6 && rec.ticks >= last;
+        last = rec.ticks;
+        n++;
+    });
+
+    // cleared records are not visited again
+    lib::log::for_each_record([](unsigned, record const&) {}, true);
+    lib::log::log("log test {}", 100);
+    unsigned after_clear = 0;
+    bool only_new = true;
+    lib::log::for_each_record([&](unsigned, record const& rec) {
+        if (is(rec, TEST_FMT)) {
+            only_new = only_new && rec.args[0] == 100;
+            after_clear++;
+        }
+    });
+
+    lib::cpu::restore_irq(flags);
+    EXPECT(n == RING_SIZE - 1);
+    EXPECT(ordered);
+    EXPECT(after_clear == 1 && only_new);
+}
+
+TEST(log, overwritten_while_reading) {
+    auto flags = lib::cpu::save_and_disable_irq();
+    lib::log::for_each_record([](unsigned, record const&) {}, true);
+
+    for (unsigned i = 0; i != RING_SIZE; ++i)
+        lib::log::log("log test {}", i);
+
+    // a whole ring of new records is written while the first one is being read, the copies of the
+    // other old ones fail the head check and they are skipped
+    unsigned old = 0, fill = 0;
+    size_t lost = lib::log::for_each_record(
+        [&](unsigned, record const& rec) {
+            if (is(rec, TEST_FMT) && !old++) {
+                for (unsigned i = 0; i != RING_SIZE; ++i)
+                    lib::log::log("log fill {}", i);
+            } else if (is(rec, FILL_FMT)) {
+                fill++;
+            }
+        },
+        true);
+
+    lib::cpu::restore_irq(flags);
+    EXPECT(old == 1);
+    EXPECT(fill == RING_SIZE - 1);
+    EXPECT(lost == RING_SIZE - 1);
+}
@@ -0,0 +1,33 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+#include <stdint.h>
+#include <test.h>
+
+import core.cpu;
+import lib.heap;
+
+namespace mmu = core::cpu::mmu;
+
+TEST(mmu, alias) {
+    constexpr uint64_t ALIAS = 256ULL << 30;
+    auto buf = static_cast<uint32_t*>(lib::heap::alloc(2 * mmu::PAGE_SIZE, mmu::PAGE_SIZE));
+    // without the MTE tag
+    auto pa = reinterpret_cast<uint64_t>(buf) & 0x00ff'ffff'ffff'ffffUL;
+
+    // same memory seen at two addresses, the alias is not tagged so there are no tag checks on it
+    EXPECT(mmu::map(ALIAS, pa, 2 * mmu::PAGE_SIZE, mmu::mem_type::NORMAL));
+    auto alias = reinterpret_cast<uint32_t volatile*>(ALIAS);
+    buf[0] = 0x1234'5678;
+    EXPECT(alias[0] == 0x1234'5678);
+    alias[1024] = 0xcafe;
+    EXPECT(buf[1024] == 0xcafe);
+
+    EXPECT(mmu::unmap(ALIAS, 2 * mmu::PAGE_SIZE));
+    EXPECT(!mmu::map(ALIAS + 1, pa, mmu::PAGE_SIZE, mmu::mem_type::NORMAL));
+
+    lib::heap::free(buf);
+}
@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+#include <stddef.h>
+#include <test.h>
+
+import lib.heap;
+import std.fixed_string;
+import std.small_vector;
+import std.static_vector;
+
+using std::fixed_string;
+using std::small_vector;
+using std::static_vector;
+
+struct bar {
+    bar(int x = 0) : val(x) { counter++; }
+    bar(bar const& b) : val(b.val) { counter++; }
+    bar(bar&& b) : val(b.val) { counter++; }
+    bar& operator=(bar const&) = default;
+    bar& operator=(bar&&) = default;
+    ~bar() { counter--; }
+    int val;
+    inline static int counter;
+};
+
+TEST(small_vector, no_heap) {
+    auto s0 = lib::heap::stats();
+    {
+        small_vector<int, 4> vec = {1, 2, 3};
+        vec.insert(vec.begin(), 0);
+        vec.erase(vec.begin());
+        vec.push_back(4);
+        EXPECT(vec.size() == 4 && vec[0] == 1 && vec[3] == 4);
+
+        small_vector<bar, 4> bars;
+        for (int i = 0; i < 4; ++i)
+            bars.emplace_back(i);
+        EXPECT(bar::counter == 4);
+        EXPECT(bars.is_inline());
+    }
+    EXPECT(bar::counter == 0);
+    EXPECT(lib::heap::stats().alloc_count == s0.alloc_count);
+}
+
+TEST(small_vector, spill) {
+    auto s0 = lib::heap::stats();
+    {
+        small_vector<bar, 2> bars;
+        for (int i = 0; i < 10; ++i)
+            bars.emplace_back(i);
+        EXPECT(!bars.is_inline());
+        EXPECT(bars.size() == 10 && bar::counter == 10);
+
+        bars.insert(bars.begin() + 1, bars[9]);
+        EXPECT(bars[1].val == 9 && bars[2].val == 1);
+
+        // the heap buffer is stolen by the new vector
+        auto moved = static_cast<small_vector<bar, 2>&&>(bars);
+        EXPECT(bars.empty() && bars.is_inline());
+        EXPECT(moved.size() == 11 && moved[10].val == 9);
+    }
+    EXPECT(bar::counter == 0);
+    EXPECT(lib::heap::stats().used == s0.used);
+}
+
+TEST(static_vector, capacity) {
+    static_vector<bar, 3> vec;
+    EXPECT(vec.push_back(bar(1)));
+    EXPECT(vec.emplace_back(2) != nullptr);
+    EXPECT(vec.insert(vec.begin(), bar(0)) == vec.begin());
+    EXPECT(vec.full());
+
+    // no room left, nothing changes
+    EXPECT(!vec.push_back(bar(3)));
+    EXPECT(vec.emplace_back(3) == nullptr);
+    EXPECT(!vec.resize(4));
+    EXPECT(vec.size() == 3 && bar::counter == 3);
+    EXPECT(vec[0].val == 0 && vec[1].val == 1 && vec[2].val == 2);
+
+    vec.erase(vec.begin());
+    EXPECT(vec.size() == 2 && vec[0].val == 1 && bar::counter == 2);
+
+    vec.clear();
+    EXPECT(bar::counter == 0);
+}
+
+TEST(fixed_string, append) {
+    fixed_string<8> str("abc");
+    str += 'd';
+    str += "ef";
+    EXPECT(str == "abcdef" && str.size() == 6);
+
+    // over the capacity the string is truncated
+    EXPECT(!str.append("ghij", 4));
+    EXPECT(str == "abcdefgh" && str.full());
+
+    str = "x";
+    EXPECT(str.size() == 1 && str != "xy");
+    EXPECT(str == fixed_string<4>("x"));
+}
@@ -0,0 +1,256 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <test.h>
+
+// sizes around the boundaries of the different copy strategies
+static constexpr size_t sizes[] = {0,  1,  2,  3,  4,  7,  8,   9,   15,  16,  17,  31,  32,  33,
+                                   63, 64, 65, 95, 96, 97, 127, 128, 129, 159, 160, 255, 256, 1000};
+
+static uint8_t buf1[1200];
+static uint8_t buf2[1200];
+static uint8_t ref[1200];
+
+static void fill(uint8_t* p, size_t n, unsigned seed) {
+    for (size_t i = 0; i < n; ++i)
+        p[i] = static_cast<uint8_t>(i * 7 + seed);
+}
+
+// byte by byte comparison, independent from the functions under test
+static bool same(uint8_t const* a, uint8_t const* b, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        if (a[i] != b[i])
+            return false;
+    return true;
+}
+
+TEST(string, memcpy) {
+    for (auto n : sizes) {
+        for (size_t soff = 0; soff < 16; soff += 3) {
+            for (size_t doff = 0; doff < 16; ++doff) {
+                fill(buf1, sizeof buf1, 1);
+                fill(buf2, sizeof buf2, 2);
+                fill(ref, sizeof ref, 2);
+                for (size_t i = 0; i < n; ++i)
+                    ref[doff + i] = buf1[soff + i];
+
+                EXPECT(memcpy(buf2 + doff, buf1 + soff, n) == buf2 + doff);
+                // bytes around the destination must not be touched
+                EXPECT(same(buf2, ref, sizeof ref));
+            }
+        }
+    }
+}
+
+TEST(string, memmove) {
+    for (auto n : sizes) {
+        for (size_t soff = 0; soff < 100; soff += 33) {
+            for (size_t doff = 0; doff < 100; doff += 7) {
+                fill(buf1, sizeof buf1, 3);
+                fill(ref, sizeof ref, 3);
+                // reference byte copy in the safe direction
+                if (doff < soff) {
+                    for (size_t i = 0; i < n; ++i)
+                        ref[doff + i] = ref[soff + i];
+                } else {
+                    for (size_t i = n; i--;)
+                        ref[doff + i] = ref[soff + i];
+                }
+
+                EXPECT(memmove(buf1 + doff, buf1 + soff, n) == buf1 + doff);
+                EXPECT(same(buf1, ref, sizeof ref));
+            }
+        }
+    }
+}
+
+TEST(string, memset) {
+    // only the low byte of the value is used
+    int const values[] = {0, 0xa5, 0x1ff};
+
+    for (auto n : sizes) {
+        for (size_t off = 0; off < 64; off += 5) {
+            for (int c : values) {
+                fill(buf1, sizeof buf1, 4);
+                fill(ref, sizeof ref, 4);
+                for (size_t i = 0; i < n; ++i)
+                    ref[off + i] = static_cast<uint8_t>(c);
+
+                EXPECT(memset(buf1 + off, c, n) == buf1 + off);
+                EXPECT(same(buf1, ref, sizeof ref));
+            }
+        }
+    }
+}
+
+TEST(string, memcmp) {
+    for (auto n : sizes) {
+        for (size_t off = 0; off < 16; off += 5) {
+            fill(buf1, sizeof buf1, 5);
+            fill(buf2, sizeof buf2, 5);
+            EXPECT(memcmp(buf1 + off, buf2 + off, n) == 0);
+            if (!n)
+                continue;
+
+            // the first different byte (compared as unsigned) gives the result, later ones don't
+            size_t const positions[] = {0, n / 2, n - 1};
+            for (size_t pos : positions) {
+                fill(buf2, sizeof buf2, 5);
+                buf2[off + pos] = static_cast<uint8_t>(buf1[off + pos] + 0x80);
+                if (pos != n - 1)
+                    buf2[off + n - 1] = static_cast<uint8_t>(buf1[off + n - 1] - 0x80);
+
+                int r = memcmp(buf1 + off, buf2 + off, n);
+                EXPECT(buf1[off + pos] < buf2[off + pos] ? r < 0 : r > 0);
+            }
+        }
+    }
+}
+
+// reference byte by byte versions to check the optimized ones
+
+static char const* ref_strchr(char const* s, char c) {
+    for (;; ++s) {
+        if (*s == c)
+            return s;
+        if (!*s)
+            return nullptr;
+    }
+}
+
+static char const* ref_strrchr(char const* s, char c) {
+    char const* p = nullptr;
+    for (;; ++s) {
+        if (*s == c)
+            p = s;
+        if (!*s)
+            return p;
+    }
+}
+
+static void const* ref_memchr(void const* src, char c, size_t n) {
+    auto s = static_cast<char const*>(src);
+    for (size_t i = 0; i < n; ++i)
+        if (s[i] == c)
+            return s + i;
+    return nullptr;
+}
+
+static int ref_strcmp(char const* a, char const* b) {
+    for (; *a && *a == *b; ++a, ++b) {}
+    return static_cast<unsigned char>(*a) - static_cast<unsigned char>(*b);
+}
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+// string of @len chars at @off in @buf, garbage after the terminator
+static char* make_str(uint8_t* buf, size_t off, size_t len, unsigned seed) {
+    fill(buf, sizeof buf1, seed + 0x80);
+    auto s = reinterpret_cast<char*>(buf + off);
+    for (size_t i = 0; i < len; ++i)
+        s[i] = static_cast<char>('a' + (i * 5 + seed) % 7);
+    s[len] = 0;
+    return s;
+}
+
+// generic word at a time versions from libc, the standard names can be arch specific ones
+extern "C" {
+int generic_strcmp(char const* s1, char const* s2);
+size_t generic_strlen(char const* s);
+size_t generic_strnlen(char const* s, size_t maxlen);
+char* generic_strchr(char const* s, int c);
+char* generic_strrchr(char const* s, int c);
+void* generic_memchr(void const* src, int c, size_t n);
+}
+
+struct scan_funcs {
+    int (*cmp)(char const*, char const*);
+    size_t (*len)(char const*);
+    size_t (*nlen)(char const*, size_t);
+    char* (*chr)(char const*, int);
+    char* (*rchr)(char const*, int);
+    void* (*mchr)(void const*, int, size_t);
+};
+
+static constexpr scan_funcs libc_funcs = {strcmp, strlen, strnlen, strchr, strrchr, memchr};
+static constexpr scan_funcs generic_funcs = {generic_strcmp, generic_strlen, generic_strnlen,
+                                             generic_strchr, generic_strrchr, generic_memchr};
+
+static void check_scan(scan_funcs const& f) {
+    for (size_t len = 0; len < 70; ++len) {
+        for (size_t off = 0; off < 32; ++off) {
+            char* s = make_str(buf1, off, len, static_cast<unsigned>(len));
+
+            EXPECT(f.len(s) == len);
+            EXPECT(f.nlen(s, len / 2) == len / 2);
+            EXPECT(f.nlen(s, len + 10) == len);
+            // s + maxlen wraps around
+            EXPECT(f.nlen(s, ~size_t(0)) == len);
+
+            char const chars[] = {'a', 'd', 'g', 'z', 0};
+            for (char c : chars) {
+                EXPECT(f.chr(s, c) == ref_strchr(s, c));
+                EXPECT(f.rchr(s, c) == ref_strrchr(s, c));
+                EXPECT(f.mchr(s, c, len / 2) == ref_memchr(s, c, len / 2));
+                EXPECT(f.mchr(s, c, len + 1) == ref_memchr(s, c, len + 1));
+            }
+            EXPECT(f.mchr(s, 0, ~size_t(0)) == s + len);
+        }
+    }
+}
+
+static void check_strcmp(scan_funcs const& f) {
+    for (size_t len = 0; len < 70; len += 3) {
+        for (size_t off1 = 0; off1 < 16; off1 += 5) {
+            for (size_t off2 = 0; off2 < 16; ++off2) {
+                char* a = make_str(buf1, off1, len, 1);
+                char* b = make_str(buf2, off2, len, 1);
+                EXPECT(f.cmp(a, b) == 0);
+
+                if (!len)
+                    continue;
+                b[len / 2] = static_cast<char>(0xe0);
+                EXPECT(sign(f.cmp(a, b)) == sign(ref_strcmp(a, b)));
+                EXPECT(sign(f.cmp(b, a)) == sign(ref_strcmp(b, a)));
+
+                b[len / 2] = 0;
+                EXPECT(sign(f.cmp(a, b)) == sign(ref_strcmp(a, b)));
+            }
+        }
+    }
+}
+
+TEST(string, scan) {
+    check_scan(libc_funcs);
+}
+
+TEST(string, scan_generic) {
+    check_scan(generic_funcs);
+}
+
+TEST(string, strcmp) {
+    check_strcmp(libc_funcs);
+}
+
+TEST(string, strcmp_generic) {
+    check_strcmp(generic_funcs);
+}
+
+TEST(string, strstr) {
+    char const* h = "abcabdabcabe";
+    EXPECT(strstr(h, "") == h);
+    EXPECT(strstr(h, "a") == h);
+    EXPECT(strstr(h, "abd") == h + 3);
+    EXPECT(strstr(h, "abe") == h + 9);
+    EXPECT(strstr(h, "abf") == nullptr);
+    EXPECT(strstr(h, "abcabeX") == nullptr);
+    EXPECT(strstr("ab", "abc") == nullptr);
+}
@@ -5,6 +5,7 @@
 
 #include <test.h>
 
+import lib.heap;
 import lib.timer;
 import lib.time;
 
@@ -65,3 +66,17 @@ TEST(timer, reschedule) {
     t.stop();
     EXPECT(counter == 5)
 }
+
+TEST(timer, no_alloc) {
+    timer t(timer::type::ONE_SHOT);
+    int counter = 0;
+    t.start([&counter] { counter++; }, 1ms);
+    delay(2ms);
+
+    // replacing the callback reuses the storage inside the timer
+    auto s0 = lib::heap::stats();
+    t.start([&counter] { counter += 10; }, 1ms);
+    delay(2ms);
+    EXPECT(counter == 11);
+    EXPECT(lib::heap::stats().alloc_count == s0.alloc_count);
+}
@@ -13,6 +13,7 @@ import std.vector;
 using std::vector;
 
 import lib.fmt;
+import lib.heap;
 using lib::fmt::println;
 
 struct foo {
@@ -20,11 +21,11 @@ struct foo {
         counter++;
         max_counter++;
     }
-    foo(foo const&) {
+    foo(foo const& f) : val(f.val) {
         counter++;
         max_counter++;
     }
-    foo(foo&&) {
+    foo(foo&& f) : val(f.val) {
         counter++;
         max_counter++;
     }
@@ -114,3 +115,98 @@ TEST(vector, erase) {
         EXPECT(i == vec[i]);
     }
 };
+
+TEST(vector, range) {
+    int src[] = {10, 11, 12};
+
+    vector<int> vec = {1, 2, 3};
+    auto it = vec.insert(vec.begin() + 1, src, src + 3);
+    EXPECT(it == vec.begin() + 1);
+    EXPECT(vec.size() == 6);
+    EXPECT(vec[0] == 1 && vec[1] == 10 && vec[3] == 12 && vec[4] == 2 && vec[5] == 3);
+
+    vec.insert(vec.end(), 2, 7);
+    EXPECT(vec.size() == 8 && vec[6] == 7 && vec[7] == 7);
+
+    it = vec.erase(vec.begin(), vec.begin() + 4);
+    EXPECT(it == vec.begin());
+    EXPECT(vec.size() == 4 && vec[0] == 2 && vec[3] == 7);
+
+    vec.assign(src, src + 2);
+    EXPECT(vec.size() == 2 && vec[0] == 10 && vec[1] == 11);
+
+    vec.assign(5, vec[1]);
+    EXPECT(vec.size() == 5 && vec[4] == 11);
+}
+
+// free bytes of all the heap regions
+static size_t heap_free() {
+    size_t n = 0;
+    for (size_t i = 0; i != lib::heap::num_regions(); ++i)
+        n += lib::heap::stats(i).free_bytes;
+    return n;
+}
+
+TEST(vector, relocation) {
+    {
+        vector<foo> vec;
+        for (int i = 0; i < 20; ++i)
+            vec.emplace_back(i);
+        vec.insert(vec.begin(), foo(-1));
+        vec.erase(vec.begin() + 5, vec.begin() + 10);
+        EXPECT(foo::counter == 16);
+        EXPECT(vec[0].val == -1 && vec[5].val == 9);
+
+        vec.shrink_to_fit();
+        EXPECT(vec.capacity() == vec.size());
+        EXPECT(foo::counter == 16);
+    }
+    EXPECT(foo::counter == 0);
+
+    // trivially copyable types grow with realloc
+    vector<int> vec;
+    for (int i = 0; i < 1000; ++i)
+        vec.push_back(i);
+    size_t free_before = heap_free();
+    vec.shrink_to_fit();
+    EXPECT(vec.capacity() == 1000);
+    // the spare capacity went back to the heap
+    EXPECT(heap_free() > free_before);
+    for (int i = 0; i < 1000; ++i)
+        EXPECT(vec[i] == i);
+
+    vec.clear();
+    vec.shrink_to_fit();
+    EXPECT(vec.capacity() == 0 && vec.data() == nullptr);
+}
+
+// copies throw once @budget runs out
+struct bomb : foo {
+    bomb(int x) : foo(x) {}
+    bomb(bomb const& b) : foo(b) {
+        if (!budget--)
+            throw budget;
+    }
+    bomb(bomb&&) = default;
+    inline static int budget;
+};
+
+TEST(vector, insert_throw) {
+    {
+        vector<bomb> vec;
+        for (int i = 0; i < 4; ++i)
+            vec.emplace_back(i);
+
+        bomb::budget = 2;
+        bool thrown = false;
+        try {
+            vec.insert(vec.begin() + 1, 3, bomb(10));
+        } catch (int) {
+            thrown = true;
+        }
+        EXPECT(thrown);
+        EXPECT(vec.size() == 4 && foo::counter == 4);
+        EXPECT(vec[0].val == 0 && vec[1].val == 1 && vec[3].val == 3);
+    }
+    EXPECT(foo::counter == 0);
+}
@@ -6,6 +6,7 @@
 
 export module arch.aarch64.mte;
 
+#include <stddef.h>
 #include <stdint.h>
 
 export namespace aarch64 {
@@ -24,4 +25,27 @@ inline uintptr_t ldg(uintptr_t addr) {
     return addr;
 }
 
+// tag two granules (32 bytes) at once
+inline void st2g(uintptr_t addr) {
+    asm volatile("st2g %0, [%0]" ::"r"(addr));
+}
+
+// zero and tag a whole dc zva block, @addr must be aligned to dczva_block_size()
+inline void dc_gzva(uintptr_t addr) {
+    asm volatile("dc gzva, %0" ::"r"(addr) : "memory");
+}
+
+// size in bytes of the block written by dc gzva, 0 if it is prohibited
+inline size_t dczva_block_size() {
+    uint64_t val;
+    asm volatile("mrs %0, dczid_el0" : "=r"(val));
+    if (val & (1 << 4))
+        return 0;
+    return 4UL << (val & 0xf);
+}
+
+inline uintptr_t get_tag(uintptr_t addr) {
+    return (addr >> 56) & 0xf;
+}
+
 }  // namespace aarch64
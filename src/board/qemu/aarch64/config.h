@@ -10,3 +10,7 @@
 #define CONFIG_STACK_SIZE      (1024 * 1024)
 #define CONFIG_HEAP_SIZE       (1024 * 1024 * 4)
 #define CONFIG_DEBUG_UART_BASE 0x09000000
+
+// MTE: tag 1 in N heap allocations, and only the ones up to MAX_SIZE bytes (0 means any size)
+#define CONFIG_AARCH64_MTE_SAMPLE_RATE     1
+#define CONFIG_AARCH64_MTE_SAMPLE_MAX_SIZE 0
@@ -7,21 +7,45 @@
 module;
 
 #include <arch/aarch64/sysreg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+
+extern "C" uint8_t __stack_end[];
 
 export module board.init;
 
 import board.debug;
 import board.peripherals;
 import arch.aarch64.smc;
+import lib.fdt;
 import lib.fmt;
+import lib.heap;
+import lib.time;
+import core.cpu;
 import core.thread;
 
 using lib::fmt::println;
+using namespace lib::time;
+
+namespace mmu = core::cpu::mmu;
+
+// PSCI 0.2 SMC64 CPU_ON and return codes
+constexpr unsigned long PSCI_CPU_ON = 0xc400'0003;
+constexpr int PSCI_SUCCESS = 0;
+constexpr int PSCI_INVALID_PARAMETERS = -2;
+constexpr int PSCI_ALREADY_ON = -4;
+
+constexpr size_t SEC_STACK_SIZE = 4096;
 
-// TODO: make this configurable
-constexpr size_t SMP_CPUS = 2;
+constexpr uint64_t MPIDR_AFF_MASK = 0xff'00ff'ffff;
+
+// the boot layout maps the first 4GB, RAM above it is mapped here
+constexpr uint64_t BOOT_MAPPED_END = 0x1'0000'0000;
+constexpr uint64_t MIN_RAM_REGION = 64 * 1024;
+// lib::allocator::simple keeps chunk sizes in 32 bits, bigger RAM ranges are split in regions
+constexpr uint64_t MAX_RAM_REGION = 0x1'0000'0000 - MIN_RAM_REGION;
 
 namespace {
 
@@ -31,6 +55,8 @@ static uint64_t tcr;
 static uint64_t ttbr0;
 static uint64_t sctlr;
 
+static lib::fdt dt;
+
 [[noreturn]] void sec_init() {
     sysreg_write(vbar_el1, vbar);
     sysreg_write(mair_el1, mair);
@@ -112,6 +138,122 @@ __attribute__((naked)) void sec_entry() {
     )" ::"S"(sec_init));
 }
 
+// logical id of the cpu with @mpidr, same mapping as core::cpu::cpu_id()
+unsigned cpu_of(uint64_t mpidr) {
+    unsigned aff1 = (mpidr >> 8) & 0xff;
+    return (mpidr & 0xff) + CONFIG_CPU_AFF0_CPU_MAX * aff1;
+}
+
+// start cpu @mpidr with its own boot stack, returns the PSCI result
+int cpu_on(uint64_t mpidr) {
+    auto stack = new uint8_t[SEC_STACK_SIZE];
+    auto sp = reinterpret_cast<unsigned long>(stack + SEC_STACK_SIZE);
+    auto r = static_cast<int>(
+        aarch64::smc(PSCI_CPU_ON, mpidr, reinterpret_cast<unsigned long>(sec_entry), sp));
+    if (r != PSCI_SUCCESS)
+        delete[] stack;
+    return r;
+}
+
+bool is_device_type(lib::fdt::node const& n, char const* type) {
+    auto s = dt.get(n, "device_type").str();
+    return s && !strcmp(s, type);
+}
+
+//
+// Start the cpus listed in the device tree, returns false if there is no cpu list
+//
+bool start_dt_cpus(unsigned& started) {
+    lib::fdt::node cpus;
+    if (!dt.find("/cpus", cpus))
+        return false;
+
+    uint64_t self = sysreg_read(mpidr_el1) & MPIDR_AFF_MASK;
+    dt.for_each_child(cpus, [&](lib::fdt::node const& n) {
+        uint64_t mpidr, size;
+        if (!is_device_type(n, "cpu") || !dt.reg(n, 0, mpidr, size) || mpidr == self)
+            return false;
+
+        if (cpu_of(mpidr) >= core::thread::MAX_CPUS) {
+            println("CPU {:#x} over MAX_CPUS, not started", mpidr);
+            return false;
+        }
+
+        auto r = cpu_on(mpidr);
+        if (r == PSCI_SUCCESS)
+            started++;
+        else if (r != PSCI_ALREADY_ON)
+            println("failed to initialize CPU {:#x} {}", mpidr, r);
+        return false;
+    });
+    return true;
+}
+
+//
+// Without a device tree, try to start every cpu we support, PSCI rejects the MPIDR of a cpu that
+// doesn't exist
+//
+void probe_cpus(unsigned& started) {
+    for (unsigned i = 1; i != core::thread::MAX_CPUS; ++i) {
+        auto r = cpu_on((i / CONFIG_CPU_AFF0_CPU_MAX) << 8 | i % CONFIG_CPU_AFF0_CPU_MAX);
+        if (r == PSCI_SUCCESS)
+            started++;
+        else if (r == PSCI_INVALID_PARAMETERS)
+            break;
+        else if (r != PSCI_ALREADY_ON)
+            println("failed to initialize CPU{} {}", i, r);
+    }
+}
+
+void add_ram(uint64_t start, uint64_t end) {
+    while (end > start && end - start >= MIN_RAM_REGION) {
+        uint64_t piece_end = end - start > MAX_RAM_REGION ? start + MAX_RAM_REGION : end;
+        if (!lib::heap::add_region("ram", reinterpret_cast<void*>(start),
+                                   reinterpret_cast<void*>(piece_end),
+                                   lib::heap::REGION_DEFAULT | lib::heap::REGION_DMA)) {
+            println("no heap region left for RAM {:#x}-{:#x}", start, end);
+            return;
+        }
+        start = piece_end;
+    }
+}
+
+//
+// The heap reserved by the linker script is small, the memory after the image (but the device
+// tree) is added to the heap for the allocations that don't fit there. RAM out of the boot layout
+// gets mapped first
+//
+void add_dt_memory() {
+    lib::fdt::node root;
+    if (!dt.find("/", root))
+        return;
+
+    auto image_end = (reinterpret_cast<uintptr_t>(__stack_end) + 15) & ~uintptr_t(15);
+    auto dtb = reinterpret_cast<uintptr_t>(core::cpu::boot_dtb());
+    auto dtb_end = dtb + dt.size();
+
+    dt.for_each_child(root, [&](lib::fdt::node const& n) {
+        if (!is_device_type(n, "memory"))
+            return false;
+
+        uint64_t base, size;
+        for (size_t i = 0; dt.reg(n, i, base, size); ++i) {
+            uint64_t start = base > image_end ? base : image_end;
+            uint64_t end = base + size < mmu::VA_SIZE ? base + size : mmu::VA_SIZE;
+            if (end > start && end > BOOT_MAPPED_END) {
+                uint64_t from = start > BOOT_MAPPED_END ? start : BOOT_MAPPED_END;
+                if (!mmu::map(from, from, end - from, mmu::RAM)) {
+                    println("no mmu tables to map RAM {:#x}-{:#x}", from, end);
+                    end = from;
+                }
+            }
+            add_ram(start, end < dtb ? end : dtb);
+            add_ram(start > dtb_end ? start : dtb_end, end);
+        }
+        return false;
+    });
+}
+
 }  // namespace
 
 export namespace board {
@@ -120,9 +262,15 @@ void early_init() {
     // initialize debug console
     board::debug::uart::init();
     printf_set_putchar_func(board::debug::uart::putchar);
+
+    // the parser doesn't need the heap, the devices take the probed values when constructed
+    if (dt.init(core::cpu::boot_dtb()))
+        peripherals::probe(dt);
 }
 
 void init() {
+    add_dt_memory();
+
     // initialize peripherals
     peripherals::init();
 }
@@ -134,14 +282,15 @@ void late_init() {
     ttbr0 = sysreg_read(ttbr0_el1);
     sctlr = sysreg_read(sctlr_el1);
 
-    constexpr int STACK_SIZE = 4096;
+    unsigned started = 0;
+    if (!start_dt_cpus(started))
+        probe_cpus(started);
 
-    for (size_t i = 1; i != SMP_CPUS; ++i) {
-        uintptr_t stack = reinterpret_cast<uintptr_t>(new uint8_t[STACK_SIZE] + STACK_SIZE);
-        auto r = aarch64::smc(0xc400'0003, i, reinterpret_cast<unsigned long>(sec_entry), stack);
-        if (r) {
-            println("failed to initialize CPU{} {:#x}", i, r);
-        }
+    // wait for the cpus to join the scheduler, so core_num is right once the shell runs
+    for (unsigned ms = 0; ms != 100; ++ms) {
+        if (__atomic_load_n(&core::thread::core_num, __ATOMIC_RELAXED) == started + 1)
+            break;
+        core::thread::sleep(1ms);
     }
 }
 
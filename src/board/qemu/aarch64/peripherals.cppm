@@ -4,6 +4,11 @@
  * Copyright (c) 2021 Fernando Lugo <lugo.fernando@gmail.com>
  */
 
+module;
+
+#include <stddef.h>
+#include <stdint.h>
+
 export module board.peripherals;
 export import device.uart.pl011;
 export import device.intc.gic;
@@ -12,20 +17,24 @@ export import device.timer.arm;
 
 import std.string;
 import device;
+import lib.fdt;
 import lib.fmt;
+import lib.time;
 
-static constexpr device::pl011::platform_data uart0_pdata{
+// defaults for the virt machine, probe() updates them from the device tree
+static device::pl011::platform_data uart0_pdata{
     .base = 0x0900'0000,
     .freq = 24'000'000,
     .baudrate = 115200,
     .irq = 33,
+    .tx_ring = 1024,
 };
 
 static device::pl011 uart0("uart0", uart0_pdata);
 
 static device::uart_console con0("con0", uart0);
 
-static constexpr device::gic::platform_data gicv2_pdata{
+static device::gic::platform_data gicv2_pdata{
     .dbase = 0x0800'0000,
     .cbase = 0x0801'0000,
 };
@@ -37,8 +46,62 @@ static device::timer_arm::platform_data timer_pdata{
 
 static device::timer_arm timer0("timer0", timer_pdata);
 
+// Compile time binding of the hot paths: prints, timers and ipis call the drivers of this
+// board directly instead of going through the device interfaces
+
+static bool console_ready;
+
+extern "C" void board_console_write(char const* s, size_t n) {
+    if (console_ready)
+        con0.write(s, n);
+}
+
+extern "C" void board_timer_set(device::timer::event* e, lib::time::time_us_t period) {
+    timer0.set(e, period);
+}
+
+extern "C" void board_send_ipi(device::intc::ipi_target target, unsigned irq) {
+    gicv2.send_ipi(target, irq);
+}
+
+// entry @idx of a GIC "interrupts" property (3 cells: type, number, flags)
+static unsigned gic_irq(lib::fdt::prop const& p, size_t idx) {
+    constexpr unsigned SPI_BASE = 32;
+    constexpr unsigned PPI_BASE = 16;
+    return p.u32(idx * 3 + 1) + (p.u32(idx * 3) ? PPI_BASE : SPI_BASE);
+}
+
 export namespace board::peripherals {
 
+//
+// probe - Take the peripherals addresses and irqs from the device tree, it has to run before the
+// devices are constructed (init_array)
+//
+void probe(lib::fdt const& dt) {
+    lib::fdt::node n;
+    uint64_t addr, size;
+
+    if (dt.find_compatible("arm,pl011", n)) {
+        if (dt.reg(n, 0, addr, size))
+            uart0_pdata.base = addr;
+        if (auto irqs = dt.get(n, "interrupts"))
+            uart0_pdata.irq = gic_irq(irqs, 0);
+    }
+
+    if (dt.find_compatible("arm,cortex-a15-gic", n)) {
+        if (dt.reg(n, 0, addr, size))
+            gicv2_pdata.dbase = addr;
+        if (dt.reg(n, 1, addr, size))
+            gicv2_pdata.cbase = addr;
+    }
+
+    // secure, non-secure, virtual and hypervisor timers, we use the non-secure one
+    if (dt.find_compatible("arm,armv8-timer", n)) {
+        if (auto irqs = dt.get(n, "interrupts"); irqs.num_cells() >= 6)
+            timer_pdata.irq = gic_irq(irqs, 1);
+    }
+}
+
 void init() {
     gicv2.init();
     // register GIC
@@ -46,6 +109,7 @@ void init() {
 
     uart0.init();
     lib::fmt::register_console(&con0);
+    console_ready = true;
 
     timer0.init();
     device::manager::register_device(&timer0);
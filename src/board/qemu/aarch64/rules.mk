@@ -11,5 +11,8 @@ else
 QEMU_MACHINE = virt,secure=on,virtualization=on
 endif
 
+# number of cpus, all of them are started at boot (up to 8)
+QEMU_SMP ?= 2
+
 qemu: $(BUILD_DIR)/sc.bin
-	$(Q)qemu-system-aarch64 -M $(QEMU_MACHINE) -cpu max -m 3072 -smp 2 -nographic -semihosting -s -kernel $<
+	$(Q)qemu-system-aarch64 -M $(QEMU_MACHINE) -cpu max -m 3072 -smp $(QEMU_SMP) -nographic -semihosting -s -kernel $<
@@ -6,7 +6,6 @@
 
 module;
 
-#include <arch/aarch64/sysreg.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -14,35 +13,28 @@ export module board.init;
 
 import board.debug;
 import board.peripherals;
+import core.cpu;
 import lib.reg;
 
 using lib::reg::reg32;
 
-static uint64_t xlate_table[4096 / 8] __attribute__((aligned(4096))) = {
-    [0] = 0x0000'070D,
-    [1] = 0x4000'070D,
-    [2] = 0x8000'0421,
-    [3] = 0xC000'0421,
+using namespace core::cpu::mmu;
+
+constexpr uint64_t GB = 1024 * 1024 * 1024;
+
+// RAM in the first 2GB, peripherals (low peripheral mode) in the last 2GB
+constexpr region layout[] = {
+    {0, 0, 2 * GB, RAM},
+    {2 * GB, 2 * GB, 2 * GB, mem_type::DEVICE_nGnRnE},
 };
 
+static constinit table xlate_table = make_table(layout);
+
 export namespace board {
 
 void early_init() {
     // init MMU, do that spin locks work
-    sysreg_write(tcr_el1, 0x1'0000'351c);
-    sysreg_write(mair_el1, 0xff44'0400UL);
-
-    sysreg_write(ttbr0_el1, reinterpret_cast<unsigned long>(xlate_table));
-
-    // enable cache
-    unsigned long r = sysreg_read(sctlr_el1);
-    r |= (1 << 12) | 0x5;
-    r &= ~(1 << 1);
-
-    sysreg_write(sctlr_el1, r);
-
-    asm volatile("dsb sy");
-    asm volatile("isb");
+    core::cpu::mmu::enable(xlate_table);
 
     // configure uart gpios
     uintptr_t GPIO_START = 0xfe20'0000;
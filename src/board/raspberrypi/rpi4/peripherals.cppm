@@ -4,6 +4,10 @@
  * Copyright (c) 2021 Fernando Lugo <lugo.fernando@gmail.com>
  */
 
+module;
+
+#include <stddef.h>
+
 export module board.peripherals;
 export import device.uart.pl011;
 export import device.console.uart;
@@ -12,6 +16,7 @@ export import device.timer.arm;
 
 import std.string;
 import lib.fmt;
+import lib.time;
 
 static constexpr device::pl011::platform_data uart0_pdata{
     .base = 0xfe20'1000,
@@ -35,11 +40,30 @@ static device::timer_arm::platform_data timer_pdata{
 
 static device::timer_arm timer0("timer0", timer_pdata);
 
+// Compile time binding of the hot paths: prints, timers and ipis call the drivers of this
+// board directly instead of going through the device interfaces
+
+static bool console_ready;
+
+extern "C" void board_console_write(char const* s, size_t n) {
+    if (console_ready)
+        con0.write(s, n);
+}
+
+extern "C" void board_timer_set(device::timer::event* e, lib::time::time_us_t period) {
+    timer0.set(e, period);
+}
+
+extern "C" void board_send_ipi(device::intc::ipi_target target, unsigned irq) {
+    gicv2.send_ipi(target, irq);
+}
+
 export namespace board::peripherals {
 
 void init() {
     uart0.init();
     lib::fmt::register_console(&con0);
+    console_ready = true;
 
     gicv2.init();
     // register GIC
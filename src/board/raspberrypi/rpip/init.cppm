@@ -15,6 +15,7 @@ import soc.rp2040;
 import board.peripherals;
 import soc.rp2040.multicore;
 import core.thread;
+import lib.boottime;
 import lib.reg;
 import soc.rp2040.mailbox;
 
@@ -42,11 +43,13 @@ void early_init() {
 
 void init() {
     soc::rp2040::init();
+    lib::boottime::mark("soc");
     peripherals::init();
 }
 
 void late_init() {
     cpu1_start();
+    peripherals::init_deferred();
 }
 
 }  // namespace board
@@ -6,6 +6,7 @@
 
 module;
 
+#include <stddef.h>
 #include <stdio.h>
 
 export module board.peripherals;
@@ -18,9 +19,11 @@ export import soc.rp2040.gpio;
 export import soc.rp2040.i2c;
 export import soc.rp2040.spi;
 
+import device.init_graph;
 import soc.rp2040.address_map;
 import std.string;
 import lib.fmt;
+import lib.time;
 import lib.exception;
 import soc.rp2040.mailbox;
 
@@ -32,6 +35,7 @@ static constexpr device::pl011::platform_data uart0_pdata{
     .freq = 125'000'000,
     .baudrate = 230400,
     .irq = 16 + 20,
+    .tx_ring = 1024,
 };
 
 static constexpr device::nvic::platform_data nvic_pdata{
@@ -84,33 +88,85 @@ static soc::rp2040::i2c i2c1("i2c1", i2c1_pdata);
 static soc::rp2040::spi spi0("spi0", spi0_pdata);
 static soc::rp2040::spi spi1("spi1", spi1_pdata);
 
-export namespace board::peripherals {
+// Compile time binding of the hot paths: prints and timers call the drivers of this board directly
+// instead of going through the device interfaces
 
-void init() {
-    nvic.init();
-    // register GIC
-    device::manager::register_device(&nvic);
+static bool console_ready;
 
-    uart0.init();
-    lib::fmt::register_console(&con0);
-    printf_set_putchar_func([](int c) {
-        uart0.putc(c);
-        return c;
-    });
+extern "C" void board_console_write(char const* s, size_t n) {
+    if (console_ready)
+        con0.write(s, n);
+}
 
-    timer0.init();
-    device::manager::register_device(&timer0);
+extern "C" void board_timer_set(device::timer::event* e, lib::time::time_us_t period) {
+    timer0.set(e, period);
+}
 
-    gpio.init();
-    device::manager::register_device(&gpio);
+// Device init steps, i2c is not needed to reach the shell so it is initialized by a thread while
+// the rest of the boot goes on
+enum step : unsigned { NVIC, UART, TIMER, GPIO, SPI, I2C0, I2C1 };
+
+static constexpr device::init_step init_steps[] = {
+    [NVIC] = {"nvic",
+              [] {
+                  nvic.init();
+                  device::manager::register_device(&nvic);
+              },
+              0, false},
+    [UART] = {"uart",
+              [] {
+                  uart0.init();
+                  lib::fmt::register_console(&con0);
+                  console_ready = true;
+                  printf_set_putchar_func([](int c) {
+                      uart0.putc(c);
+                      return c;
+                  });
+              },
+              1 << NVIC, false},
+    [TIMER] = {"timer",
+               [] {
+                   timer0.init();
+                   device::manager::register_device(&timer0);
+               },
+               1 << NVIC, false},
+    [GPIO] = {"gpio",
+              [] {
+                  gpio.init();
+                  device::manager::register_device(&gpio);
+              },
+              1 << NVIC, false},
+    [SPI] = {"spi",
+             [] {
+                 device::manager::register_device(&spi0);
+                 device::manager::register_device(&spi1);
+             },
+             0, false},
+    [I2C0] = {"i2c0",
+              [] {
+                  i2c0.init();
+                  device::manager::register_device(&i2c0);
+              },
+              1 << GPIO, true},
+    [I2C1] = {"i2c1",
+              [] {
+                  i2c1.init();
+                  device::manager::register_device(&i2c1);
+              },
+              1 << GPIO, true},
+};
 
-    i2c0.init();
-    i2c1.init();
-    device::manager::register_device(&i2c0);
-    device::manager::register_device(&i2c1);
+static device::init_graph init_graph(init_steps);
+
+export namespace board::peripherals {
+
+void init() {
+    init_graph.run();
+}
 
-    device::manager::register_device(&spi0);
-    device::manager::register_device(&spi1);
+// needs threads running
+void init_deferred() {
+    init_graph.run_deferred();
 }
 
 void init_sec() {
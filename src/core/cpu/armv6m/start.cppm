@@ -6,11 +6,16 @@
 
 module;
 
+#include <stddef.h>
 #include <stdint.h>
-#include <string.h>
 
 extern "C" [[noreturn]] void init();
 
+// memcpy/memset may be overridden by versions that keep state in .data (e.g. boot ROM bindings),
+// so sections are set up with the plain libc versions
+extern "C" void* __memcpy_armv6m(void* dest, void const* src, size_t n);
+extern "C" void* __memset_armv6m(void* s, int c, size_t n);
+
 export module core.cpu.armv6m.start;
 
 export namespace core::cpu {
@@ -23,10 +28,10 @@ extern "C" uint8_t __data_end[];
 
 extern "C" void _start() {
     // init .bss section
-    memset(__bss_start, 0, __bss_end - __bss_start);
+    __memset_armv6m(__bss_start, 0, __bss_end - __bss_start);
 
     // move data from flash to RAM
-    memcpy(__data_start, __fdata, __data_end - __data_start);
+    __memcpy_armv6m(__data_start, __fdata, __data_end - __data_start);
 
     init();
 }
@@ -15,6 +15,7 @@ module;
 export module core.cpu.arch;
 
 export import core.cpu.armv8.common;
+export import core.cpu.armv8.mmu;
 
 import core.cpu.armv8.exception;
 import lib.fmt;
@@ -23,33 +24,22 @@ using lib::fmt::println;
 
 export using cpu_irq_handler = void(*)(int vec, void* data);
 
+// device tree address passed by the boot loader, saved by start.S (0 if there is none)
+extern "C" uintptr_t __boot_dtb;
+
 namespace core::cpu {
 
-#ifdef CONFIG_AARCH64_MTE
-// 1:1 mmu mapping of the first 4GB
-static uint64_t xlate_table[4096 / 8] __attribute__((aligned(4096))) = {
-    // clang-format off
-    [0] = 0x00000421, // 1GB device memory
-    [1] = 0x40000711, // 1GB tagged memory
-    [2] = 0x80000711, // 1GB tagged memory
-    [3] = 0xc0000711, // 1GB tagged memory
-};
-#else
-// 1:1 mmu mapping of the first 4GB
-static uint64_t xlate_table[4096 / 8] __attribute__((aligned(4096))) = {
-    // clang-format off
-    [0] = 0x00000421, // 1GB device memory
-    [1] = 0x4000070d, // 1GB writeback memory
-    [2] = 0x8000070d, // 1GB writeback memory
-    [3] = 0xc000070d, // 1GB writeback memory
-
-    // mirror normal memory as tagged memory
-    //[5] = 0x40000711, // 1GB tagged memory
-    //[6] = 0x80000711, // 1GB tagged memory
-    //[7] = 0xc0000711, // 1GB tagged memory
-    // clang-format off
+using namespace mmu;
+
+constexpr uint64_t GB = 1024 * 1024 * 1024;
+
+// 1:1 mapping of the first 4GB, boards add what is outside (e.g. RAM above 4GB) with mmu::map()
+constexpr region boot_layout[] = {
+    {0, 0, 1 * GB, mem_type::DEVICE_nGnRnE},
+    {1 * GB, 1 * GB, 3 * GB, RAM},
 };
-#endif
+
+static constinit table boot_table = make_table(boot_layout);
 
 static cpu_irq_handler cpu_handler;
 static void* cpu_handler_data;
@@ -62,33 +52,12 @@ static int cpu_exception_handler(armv8::exception::regs*) {
     return 0;
 }
 
-static void mmu_init() {
-#ifdef CONFIG_AARCH64_MTE
-    //sysreg_write(tcr_el1, 0x1'0000'351cUL | (1ULL << 37)); // 36bits
-    sysreg_write(tcr_el1, 0x0000'3520UL | (1ULL << 37));
-    sysreg_write(mair_el1, 0xf0'ff44'0400UL);
-#else
-    sysreg_write(tcr_el1, 0x0000'3520UL);
-    sysreg_write(mair_el1, 0xff44'0400UL);
-#endif
-
-    sysreg_write(ttbr0_el1, xlate_table);
-
-    unsigned long val = sysreg_read(sctlr_el1);
-    // enable mmu and D/I caches
-    val |= (1 << 12) | (1 << 2) | 1;
-    sysreg_write(sctlr_el1, val);
-
-    asm volatile("dsb sy");
-    asm volatile("isb");
-}
-
 }  // namespace core::cpu
 
 export namespace core::cpu {
 
 void early_init() {
-    mmu_init();
+    mmu::enable(boot_table);
 }
 
 void init() {
@@ -101,4 +70,8 @@ void register_irq_handler(cpu_irq_handler handler, void* data) {
     cpu_handler_data = data;
 }
 
+void const* boot_dtb() {
+    return reinterpret_cast<void const*>(__boot_dtb);
+}
+
 }  // namespace core::cpu
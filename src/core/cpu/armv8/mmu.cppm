@@ -0,0 +1,402 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Stage 1 EL1 translation tables, 4KB granule and 39 bits VA (512GB) starting at level 1
+ *
+ * The coarse layout known at build time is a constexpr level 1 table of 1GB blocks (see
+ * make_table()), everything finer is done at runtime with map()/unmap(). They use the biggest
+ * mapping that fits (1GB, 2MB or 4KB), splitting blocks when only part of them changes. Tables come
+ * from a static pool, so it works before the heap is up.
+ *
+ * Mappings are execute never unless MAP_EXEC is given, enable() maps the image itself: text is
+ * read-only executable, rodata read-only and the rest read/write.
+ */
+
+module;
+
+#include <arch/aarch64/sysreg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" uint8_t __text_start[];
+extern "C" uint8_t __rodata_start[];
+extern "C" uint8_t __data_start[];
+extern "C" uint8_t __stack_end[];
+
+export module core.cpu.armv8.mmu;
+
+import lib.cache;
+import lib.lock;
+
+using lib::lock;
+using lib::slock_irqsafe;
+
+#ifndef CONFIG_MMU_TABLES
+#define CONFIG_MMU_TABLES 16
+#endif
+
+export namespace core::cpu::mmu {
+
+constexpr unsigned VA_BITS = 39;
+constexpr uint64_t VA_SIZE = 1ULL << VA_BITS;
+constexpr uint64_t PAGE_SIZE = 4096;
+constexpr size_t ENTRIES = PAGE_SIZE / sizeof(uint64_t);
+
+// memory types, the values are the MAIR attribute indexes
+enum class mem_type : unsigned {
+    DEVICE_nGnRnE = 0,
+    DEVICE = 1,     // nGnRE
+    NORMAL_NC = 2,  // normal non cacheable, e.g. DMA buffers without coherency
+    NORMAL = 3,     // normal write back
+    TAGGED = 4,     // normal write back with MTE tags (CONFIG_AARCH64_MTE only)
+};
+
+#ifdef CONFIG_AARCH64_MTE
+constexpr mem_type RAM = mem_type::TAGGED;
+#else
+constexpr mem_type RAM = mem_type::NORMAL;
+#endif
+
+enum map_flags : unsigned {
+    MAP_READ_ONLY = 1 << 0,
+    MAP_EXEC = 1 << 1,  // ignored for device memory
+};
+
+struct region {
+    uint64_t va;
+    uint64_t pa;
+    uint64_t size;
+    mem_type type;
+    unsigned flags = 0;
+};
+
+struct table {
+    alignas(PAGE_SIZE) uint64_t entries[ENTRIES];
+};
+
+// size mapped by an entry of a table at @level (1 to 3)
+constexpr uint64_t block_size(unsigned level) {
+    return 1ULL << (12 + 9 * (3 - level));
+}
+
+}  // namespace core::cpu::mmu
+
+namespace core::cpu::mmu {
+
+constexpr uint64_t DESC_VALID = 1 << 0;
+constexpr uint64_t DESC_TABLE = 1 << 1;  // next level table, or page at level 3
+constexpr uint64_t DESC_NS = 1 << 5;
+constexpr uint64_t DESC_RO = 1 << 7;  // AP[2]
+constexpr uint64_t DESC_ISH = 3 << 8;
+constexpr uint64_t DESC_AF = 1 << 10;
+constexpr uint64_t DESC_PXN = 1ULL << 53;
+constexpr uint64_t DESC_UXN = 1ULL << 54;
+constexpr uint64_t DESC_ADDR = 0x0000'ffff'ffff'f000;
+
+// bits 2-11 and 52-63 of a block/page descriptor
+constexpr uint64_t DESC_ATTRS = ~DESC_ADDR & ~(DESC_VALID | DESC_TABLE);
+
+constexpr uint64_t desc_attrs(mem_type type, unsigned flags) {
+    uint64_t d = DESC_AF | DESC_NS | uint64_t(type) << 2;
+    bool device = type < mem_type::NORMAL_NC;
+    if (!device)
+        d |= DESC_ISH;
+    if (flags & MAP_READ_ONLY)
+        d |= DESC_RO;
+    if (device || !(flags & MAP_EXEC))
+        d |= DESC_PXN | DESC_UXN;
+    return d;
+}
+
+constexpr uint64_t leaf(uint64_t pa, uint64_t attrs, unsigned level) {
+    return pa | attrs | DESC_VALID | (level == 3 ? DESC_TABLE : 0);
+}
+
+constexpr unsigned index(uint64_t va, unsigned level) {
+    return (va >> (12 + 9 * (3 - level))) & (ENTRIES - 1);
+}
+
+table pool[CONFIG_MMU_TABLES];
+size_t pool_used;
+table* free_tables;  // freed tables, linked through their first entry
+table* root;
+uint64_t pa_size;
+lock mmu_lock;
+
+table* alloc_table() {
+    table* t;
+    if (free_tables) {
+        t = free_tables;
+        free_tables = reinterpret_cast<table*>(t->entries[0]);
+    } else if (pool_used < CONFIG_MMU_TABLES) {
+        t = &pool[pool_used++];
+    } else {
+        return nullptr;
+    }
+
+    // not memset, it can use dc zva which faults while the mmu is off
+    volatile uint64_t* e = t->entries;
+    for (size_t i = 0; i != ENTRIES; ++i)
+        e[i] = 0;
+    return t;
+}
+
+bool is_table(uint64_t e, unsigned level) {
+    return level < 3 && (e & (DESC_VALID | DESC_TABLE)) == (DESC_VALID | DESC_TABLE);
+}
+
+table* table_of(uint64_t e) {
+    // tables are identity mapped
+    return reinterpret_cast<table*>(e & DESC_ADDR);
+}
+
+// free table @t of @level and the tables below it
+void free_table(table* t, unsigned level) {
+    for (size_t i = 0; i != ENTRIES; ++i)
+        if (is_table(t->entries[i], level))
+            free_table(table_of(t->entries[i]), level + 1);
+
+    t->entries[0] = reinterpret_cast<uint64_t>(free_tables);
+    free_tables = t;
+}
+
+void tlb_flush() {
+    asm volatile(
+        "dsb ishst\n"
+        "tlbi vmalle1is\n"
+        "dsb ish\n"
+        "isb" ::
+            : "memory");
+}
+
+//
+// Replace entry @e (of a table at @level) with @desc, doing break-before-make when a valid
+// translation changes
+//
+void set_entry(uint64_t& e, uint64_t desc, unsigned level) {
+    auto& ve = reinterpret_cast<volatile uint64_t&>(e);
+    uint64_t old = ve;
+
+    if (old & DESC_VALID) {
+        ve = 0;
+        tlb_flush();
+    }
+    ve = desc;
+    asm volatile("dsb ishst\nisb" ::: "memory");
+
+    if (is_table(old, level) && !is_table(desc, level))
+        free_table(table_of(old), level + 1);
+}
+
+// true if the mmu is on and walking @root
+bool root_is_live() {
+    return (sysreg_read(sctlr_el1) & 1) &&
+           (sysreg_read(ttbr0_el1) & DESC_ADDR) == reinterpret_cast<uint64_t>(root);
+}
+
+//
+// A block is split with break-before-make (without FEAT_BBM, e.g. cortex-a72, changing the block
+// size of a live translation in place is not allowed), so it is unmapped for a moment. That can't
+// be done to the block with the image (this code, the tables, the boot stack) or the current stack
+// while the mmu uses it. Other cpus must not access a block while it is split
+//
+bool can_split(uint64_t va, unsigned level) {
+    if (!root_is_live())
+        return true;
+
+    uint64_t start = va & ~(block_size(level) - 1);
+    uint64_t end = start + block_size(level);
+    auto in_block = [&](uint64_t a) { return a >= start && a < end; };
+    auto image = reinterpret_cast<uint64_t>(__text_start);
+    auto image_end = reinterpret_cast<uint64_t>(__stack_end);
+    auto sp = reinterpret_cast<uint64_t>(__builtin_frame_address(0));
+
+    return !(image < end && image_end > start) && !in_block(sp);
+}
+
+//
+// Entry for @va in the table at @level, splitting blocks on the way. When @create is false missing
+// tables are not allocated, the invalid entry of the upper level is returned instead. Returns
+// nullptr if there are no tables left or a block that is in use can't be split (see can_split())
+//
+uint64_t* walk(uint64_t va, unsigned level, bool create = true) {
+    table* t = root;
+    for (unsigned l = 1; l != level; ++l) {
+        uint64_t& e = t->entries[index(va, l)];
+        if (!(e & DESC_VALID)) {
+            if (!create)
+                return &e;
+            auto n = alloc_table();
+            if (!n)
+                return nullptr;
+            set_entry(e, reinterpret_cast<uint64_t>(n) | DESC_TABLE | DESC_VALID, l);
+        } else if (!is_table(e, l)) {
+            // block, the new table maps the same memory with the same attributes
+            if (!can_split(va, l))
+                return nullptr;
+            auto n = alloc_table();
+            if (!n)
+                return nullptr;
+            uint64_t pa = e & DESC_ADDR;
+            uint64_t bs = block_size(l + 1);
+            for (size_t i = 0; i != ENTRIES; ++i)
+                n->entries[i] = leaf(pa + i * bs, e & DESC_ATTRS, l + 1);
+            set_entry(e, reinterpret_cast<uint64_t>(n) | DESC_TABLE | DESC_VALID, l);
+        }
+        t = table_of(e);
+    }
+    return &t->entries[index(va, level)];
+}
+
+// biggest level whose blocks fit at @va/@pa with @size left
+unsigned fit_level(uint64_t va, uint64_t pa, uint64_t size) {
+    unsigned level = 1;
+    for (; level != 3; ++level) {
+        uint64_t bs = block_size(level);
+        if (!(va % bs) && !(pa % bs) && size >= bs)
+            break;
+    }
+    return level;
+}
+
+bool map_range(uint64_t va, uint64_t pa, uint64_t size, uint64_t attrs) {
+    if ((va | pa | size) % PAGE_SIZE || va + size > VA_SIZE || va + size < va ||
+        pa + size > pa_size)
+        return false;
+
+    while (size) {
+        unsigned level = fit_level(va, pa, size);
+        auto e = walk(va, level);
+        if (!e)
+            return false;
+        set_entry(*e, leaf(pa, attrs, level), level);
+
+        uint64_t bs = block_size(level);
+        va += bs;
+        pa += bs;
+        size -= bs;
+    }
+    return true;
+}
+
+// image sections, the boundaries are page aligned by the linker script
+void map_image() {
+    auto addr = [](uint8_t* p) { return reinterpret_cast<uint64_t>(p); };
+    uint64_t end = (addr(__stack_end) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    map_range(addr(__text_start), addr(__text_start), addr(__rodata_start) - addr(__text_start),
+              desc_attrs(RAM, MAP_READ_ONLY | MAP_EXEC));
+    map_range(addr(__rodata_start), addr(__rodata_start),
+              addr(__data_start) - addr(__rodata_start), desc_attrs(RAM, MAP_READ_ONLY));
+    map_range(addr(__data_start), addr(__data_start), end - addr(__data_start), desc_attrs(RAM, 0));
+}
+
+}  // namespace core::cpu::mmu
+
+export namespace core::cpu::mmu {
+
+//
+// make_table - Level 1 table for @regions at build time, regions must be 1GB aligned
+//
+template <size_t N>
+consteval table make_table(region const (&regions)[N]) {
+    table t{};
+    for (auto& r : regions) {
+        uint64_t bs = block_size(1);
+        if (r.va % bs || r.pa % bs || r.size % bs || r.va + r.size > VA_SIZE)
+            throw "mmu: static regions must be 1GB aligned";
+        for (uint64_t off = 0; off != r.size; off += bs)
+            t.entries[index(r.va + off, 1)] = leaf(r.pa + off, desc_attrs(r.type, r.flags), 1);
+    }
+    return t;
+}
+
+//
+// enable - Map the image in @t and start using it, the mmu can be on already
+//
+void enable(table& t) {
+    // 0: device nGnRnE, 1: device nGnRE, 2: normal non cacheable, 3: normal WB, 4: tagged WB
+#ifdef CONFIG_AARCH64_MTE
+    constexpr uint64_t MAIR = 0xf0'ff44'0400UL;
+    constexpr uint64_t TCR_TBI0 = 1ULL << 37;
+#else
+    constexpr uint64_t MAIR = 0xff44'0400UL;
+    constexpr uint64_t TCR_TBI0 = 0;
+#endif
+    constexpr uint64_t TCR_T0SZ = 64 - VA_BITS;
+    constexpr uint64_t TCR_WB_ISH = (1 << 8) | (1 << 10) | (3 << 12);  // walks WB inner shareable
+    constexpr uint64_t TCR_EPD1 = 1 << 23;  // no TTBR1 walks
+
+    // output addresses up to 40 bits (VA_BITS + 1), or less if the cpu doesn't have them
+    uint64_t ips = sysreg_read(id_aa64mmfr0_el1) & 0xf;
+    if (ips > 2)
+        ips = 2;
+    constexpr unsigned pa_bits[] = {32, 36, 40};
+    pa_size = 1ULL << pa_bits[ips];
+
+    root = &t;
+    map_image();
+
+    // tables written with the mmu off went straight to memory, drop any stale line the (cacheable)
+    // table walks could hit
+    if (!(sysreg_read(sctlr_el1) & 1)) {
+        lib::cache::invalidate(pool, sizeof(pool));
+        lib::cache::invalidate(root, sizeof(*root));
+    }
+
+    sysreg_write(mair_el1, MAIR);
+    sysreg_write(tcr_el1, TCR_T0SZ | TCR_WB_ISH | TCR_EPD1 | TCR_TBI0 | ips << 32);
+    sysreg_write(ttbr0_el1, reinterpret_cast<uint64_t>(root));
+    tlb_flush();
+
+    unsigned long val = sysreg_read(sctlr_el1);
+    // enable mmu and D/I caches, no alignment checks
+    val |= (1 << 12) | (1 << 2) | 1;
+    val &= ~(1UL << 1);
+    sysreg_write(sctlr_el1, val);
+
+    asm volatile("dsb sy");
+    asm volatile("isb");
+}
+
+//
+// map - Map @size bytes at @va to @pa, replacing what was there
+//
+// Addresses and size must be page aligned. Changing the memory type of memory in use (e.g. to
+// non cacheable) doesn't touch the caches, the caller has to lib::cache::clean_invalidate() it.
+// Blocks only partially covered are split, with the mmu on that can't be done to the block of the
+// image or the caller stack. Returns false if the range is invalid, there are no tables left or a
+// block can't be split (part of it can be mapped).
+//
+bool map(uint64_t va, uint64_t pa, uint64_t size, mem_type type, unsigned flags = 0) {
+    slock_irqsafe guard(mmu_lock);
+    return map_range(va, pa, size, desc_attrs(type, flags));
+}
+
+//
+// unmap - Remove the mappings of @size bytes at @va, addresses must be page aligned
+//
+bool unmap(uint64_t va, uint64_t size) {
+    if ((va | size) % PAGE_SIZE || va + size > VA_SIZE || va + size < va)
+        return false;
+
+    slock_irqsafe guard(mmu_lock);
+    while (size) {
+        unsigned level = fit_level(va, va, size);
+        uint64_t bs = block_size(level);
+        auto e = walk(va, level, false);
+        if (!e)
+            return false;  // the block can't be split
+        set_entry(*e, 0, level);
+
+        va += bs;
+        size -= bs;
+    }
+    return true;
+}
+
+}  // namespace core::cpu::mmu
@@ -8,12 +8,14 @@
 
 import board.init;
 import board.power;
+import lib.boottime;
 import lib.heap;
 import lib.fmt;
 import core.cpu;
 import core.thread;
 
 using lib::fmt::println;
+namespace boottime = lib::boottime;
 
 extern void (*__init_array_start[])();
 extern void (*__init_array_end[])();
@@ -33,18 +35,25 @@ __attribute__((weak)) int main() {
 extern "C" [[noreturn]] void init() {
     core::cpu::early_init();
     board::early_init();
+    boottime::mark("early_init");
 
     lib::heap::init();
+    boottime::mark("heap");
 
     init_array();
+    boottime::mark("init_array");
 
     core::cpu::init();
+    boottime::mark("cpu");
     board::init();
+    boottime::mark("board");
 
     // init thread framework, after that we will be running in the main thread
     core::thread::init();
+    boottime::mark("thread");
 
     board::late_init();
+    boottime::mark("late_init");
 
     println("Welcome to SC");
 
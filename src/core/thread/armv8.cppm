@@ -162,7 +162,10 @@ void arch_idle() {
 }
 
 void arch_kick() {
-    intc->send_ipi(device::intc::ipi_target::ALL_BUT_ME, 10);
+    if (board_send_ipi)
+        board_send_ipi(device::intc::ipi_target::ALL_BUT_ME, 10);
+    else
+        intc->send_ipi(device::intc::ipi_target::ALL_BUT_ME, 10);
 }
 
 }  // namespace core::thread
@@ -6,6 +6,7 @@
 
 module;
 
+#include <errcodes.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -18,12 +19,14 @@ import std.memory;
 import std.vector;
 import lib.exception;
 import lib.fmt;
+import lib.heap;
 import device;
 import lib.lock;
 import lib.time;
 import lib.elist;
 import lib.equeue;
 import lib.cpu;
+import lib.log;
 
 using lib::equeue;
 using lib::exception;
@@ -38,13 +41,13 @@ using std::vector;
 
 using namespace lib::time;
 
-constexpr unsigned MAX_CPUS = 8;
-
 constexpr size_t THREAD_STACK_SIZE = 1024 * 32;
 using entry_t = void (*)(void*);
 
 export namespace core::thread {
 
+constexpr unsigned MAX_CPUS = lib::cpu::MAX_CPUS;
+
 enum class state {
     READY,
     BLOCKED,
@@ -76,6 +79,15 @@ class thread_t : public thread_arch, public lib::elist_node {
     state state;
     unsigned affinity;
 
+    // C++ runtime exception handling state (caught exceptions stack), see __cxa_get_globals()
+    struct {
+        void* caught;
+        unsigned uncaught;
+    } eh_globals = {};
+
+    // lib::fmt output buffer, see fmt_get_line_buffer()
+    lib::fmt::line_buffer fmt_line = {};
+
  private:
     entry_t entry;
     void* arg;
@@ -139,6 +151,19 @@ static aqueue ready_queue;
 static thread_t* idle_threads[MAX_CPUS];
 static device::timer* dev;
 
+// threads bound to a single cpu get their stack from memory local to that cpu when there is one
+static uint8_t* alloc_stack(size_t size, unsigned affinity) {
+    void* p;
+    if (affinity && !(affinity & (affinity - 1)))
+        p = lib::heap::alloc(size, 16, lib::heap::hint::CORE_LOCAL, __builtin_ctz(affinity));
+    else
+        p = lib::heap::alloc(size, 16);
+
+    if (!p)
+        throw exception("no memory for thread stack", ERR_NO_MEMORY);
+    return static_cast<uint8_t*>(p);
+}
+
 }  // namespace core::thread
 
 export namespace core::thread {
@@ -147,6 +172,20 @@ thread_t* current() {
     return reinterpret_cast<thread_t*>(thread_current_addr());
 }
 
+// C++ runtime uses this to keep track of the exceptions being handled by the current thread
+extern "C" void* __cxa_get_globals() {
+    static decltype(thread_t::eh_globals) boot_eh_globals;
+    auto t = current();
+    return t ? &t->eh_globals : &boot_eh_globals;
+}
+
+// lib::fmt collects the output of each print in the buffer of the current thread, before threads
+// are running it writes directly to the console
+extern "C" void* fmt_get_line_buffer() {
+    auto t = current();
+    return t ? &t->fmt_line : nullptr;
+}
+
 unsigned core_num = 1;
 
 void schedule() {
@@ -179,7 +218,7 @@ void schedule() {
         new_t = ready_queue.aff_pop();
     }
 
-    // println("[{}] {} switching to {}", cpu, t->name, new_t->name);
+    lib::log::log("switching {:p} to {:p}", t, new_t);
 
     if (t != idle_thread && t->state == state::RUNNING) {
         t->state = state::READY;
@@ -216,7 +255,10 @@ void sleep(time_ms_t period) {
     auto e = dev->create(device::timer::type::ONE_SHOT, sleep_timer_cb, t);
     lock_irqsafe_for(thread_lock, [&] {
         t->state = state::ASLEEP;
-        dev->set(e, period);
+        if (board_timer_set)
+            board_timer_set(e, period);
+        else
+            dev->set(e, period);
     });
     while (t->state == state::ASLEEP)
         schedule();
@@ -273,7 +315,7 @@ void init() {
     idle_thread->entry = thread_idle;
     idle_thread->arg = nullptr;
     idle_thread->state = state::READY;
-    idle_thread->stack.reset(new uint8_t[IDLE_THREAD_STACK_SIZE]);
+    idle_thread->stack.reset(alloc_stack(IDLE_THREAD_STACK_SIZE, 1 << cpu));
     idle_thread->stack_size = IDLE_THREAD_STACK_SIZE;
     auto sp = reinterpret_cast<uintptr_t>(idle_thread->stack.get()) + idle_thread->stack_size;
     auto pc = reinterpret_cast<uintptr_t>(&idle_thread->thread_entry);
@@ -313,7 +355,7 @@ thread_t::thread_t(string const& name, entry_t entry, void* arg, unsigned affini
       affinity(affinity),
       entry(entry),
       arg(arg),
-      stack(new uint8_t[stack_size_]),
+      stack(alloc_stack(stack_size_, affinity)),
       stack_size(stack_size_) {
     auto sp = reinterpret_cast<uintptr_t>(stack.get()) + stack_size;
     auto pc = reinterpret_cast<uintptr_t>(&thread_entry);
@@ -4,6 +4,10 @@
  * Copyright (c) 2021 Fernando Lugo <lugo.fernando@gmail.com>
  */
 
+module;
+
+#include <stddef.h>
+
 export module device.console;
 
 import device;
@@ -21,6 +25,12 @@ class console : public device {
     // console interface
     virtual void putc(int c, bool wait = true) = 0;
     virtual int getc(bool wait = true) = 0;
+
+    // write @n chars, consoles that can do burst writes should override it
+    virtual void write(char const* buf, size_t n) {
+        for (size_t i = 0; i != n; ++i)
+            putc(buf[i]);
+    }
 };
 
 // console device concept
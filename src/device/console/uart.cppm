@@ -4,6 +4,10 @@
  * Copyright (c) 2021 Fernando Lugo <lugo.fernando@gmail.com>
  */
 
+module;
+
+#include <stddef.h>
+
 export module device.console.uart;
 
 import device;
@@ -13,15 +17,19 @@ import std.string;
 
 export namespace device {
 
-class uart_console : public console {
+// @U is the uart driver, it is deduced from the constructor so boards binding their concrete driver
+// call it directly. uart_console<> goes through the uart interface
+template <typename U = uart>
+class uart_console final : public console {
  public:
-    uart_console(std::string const& name, uart& uart) : console(name), uart(uart) {}
+    uart_console(std::string const& name, U& uart) : console(name), uart(uart) {}
 
     void putc(int c, bool wait = true) override { uart.putc(c, wait); }
     int getc(bool wait = true) override { return uart.getc(wait); }
+    void write(char const* buf, size_t n) override { uart.write(buf, n); }
 
  private:
-    uart& uart;
+    U& uart;
 };
 
 }  // namespace device
@@ -16,17 +16,28 @@
  *   device
  */
 
+module;
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
 export module device;
 
+import std.small_vector;
 import std.string;
-import std.vector;
 import lib.exception;
+import lib.lock;
 
 using lib::exception;
-using std::vector;
+using lib::slock_irqsafe;
+using std::small_vector;
 
 export namespace device {
 
+// find_all() results are short lived and small, they are kept out of the heap up to this size
+constexpr size_t FIND_ALL_INLINE = 8;
+
 enum class class_type {
     NONE,
     UART,
@@ -37,13 +48,25 @@ enum class class_type {
     PWM,
     I2C,
     SPI,
+    MAX,  // number of types, keep it last
 };
 
+// FNV-1a, device names are hashed once when the device is created
+constexpr uint32_t name_hash(char const* s, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i != n; ++i)
+        h = (h ^ static_cast<uint8_t>(s[i])) * 16777619u;
+    return h;
+}
+
+class manager;
+
 class device {
  public:
     constexpr static class_type dev_type = class_type::NONE;
 
-    device(std::string const& name) : name_(name) {}
+    device(std::string const& name)
+        : name_(name), name_hash_(name_hash(name.c_str(), name.size())) {}
 
     std::string const& name() { return name_; }
 
@@ -57,86 +80,162 @@ class device {
     device(device&&) = delete;
 
  private:
+    friend class manager;
+
     std::string name_;
+    uint32_t name_hash_;
+    // registry links, see manager
+    device* next_ = nullptr;
+    device* hash_next_ = nullptr;
 };
 
 }  // namespace device
 
+//
+// Device registry: one list per class_type and a hash table of names. Lookups don't take any lock,
+// writers serialize on a lock and publish list updates with release stores (RCU style). An
+// unregistered device keeps its links, so a lookup walking it at that moment still reaches the
+// rest of the list; the device itself must stay alive until such lookups are done.
+//
 namespace device {
-static vector<device*> devices;
+
+constexpr size_t NAME_BUCKETS = 32;
+
+static device* type_lists[static_cast<size_t>(class_type::MAX)];
+static device* name_buckets[NAME_BUCKETS];
+static lib::lock registry_lock;
+// bumped on every unregister, handles look up their device again when it changes
+static unsigned registry_gen;
+
+device* load(device* const& p) {
+    return __atomic_load_n(&p, __ATOMIC_ACQUIRE);
 }
 
+void publish(device*& p, device* dev) {
+    __atomic_store_n(&p, dev, __ATOMIC_RELEASE);
+}
+
+}  // namespace device
+
 export namespace device {
 
 class manager {
  public:
-    static void register_device(device* dev) { devices.push_back(dev); }
+    static void register_device(device* dev) {
+        slock_irqsafe guard(registry_lock);
+
+        // links have to be ready before the device is published
+        auto& bucket = name_buckets[dev->name_hash_ % NAME_BUCKETS];
+        dev->next_ = nullptr;
+        dev->hash_next_ = bucket;
+        publish(bucket, dev);
+
+        // keep registration order, find() returns the first device of a type
+        device** p = &type_lists[static_cast<size_t>(dev->type())];
+        while (*p)
+            p = &(*p)->next_;
+        publish(*p, dev);
+    }
 
     static void unregister_device(device* dev) {
-        for (auto it = devices.begin(); it != devices.end(); ++it) {
-            if (*it == dev) {
-                devices.erase(it);
-                return;
-            }
-        }
+        slock_irqsafe guard(registry_lock);
+        unlink(&type_lists[static_cast<size_t>(dev->type())], dev, &device::next_);
+        unlink(&name_buckets[dev->name_hash_ % NAME_BUCKETS], dev, &device::hash_next_);
+        __atomic_store_n(&registry_gen, registry_gen + 1, __ATOMIC_RELEASE);
     }
 
-    static device* find(class_type type) {
-        for (auto dev : devices) {
-            if (dev->type() == type)
-                return dev;
-        }
-        return nullptr;
-    }
+    static unsigned generation() { return __atomic_load_n(&registry_gen, __ATOMIC_ACQUIRE); }
+
+    static device* find(class_type type) { return load(type_lists[static_cast<size_t>(type)]); }
 
     // TODO: create Device concept
     template <typename D>
     static D* find() {
-        for (auto dev : devices) {
-            if (dev->type() == D::dev_type)
-                return static_cast<D*>(dev);
-        }
-        return nullptr;
+        return static_cast<D*>(find(D::dev_type));
     }
 
-    static vector<device*> find_all(class_type type) {
-        vector<device*> dev_list;
+    static small_vector<device*, FIND_ALL_INLINE> find_all(class_type type) {
+        small_vector<device*, FIND_ALL_INLINE> dev_list;
 
-        for (auto dev : devices) {
-            if (dev->type() == type)
-                dev_list.push_back(dev);
-        }
+        for (auto dev = find(type); dev; dev = load(dev->next_))
+            dev_list.push_back(dev);
         return dev_list;
     }
 
     // TODO: create Device concept
     template <typename D>
-    static vector<D*> find_all() {
-        vector<D*> dev_list;
-        for (auto dev : devices) {
-            if (dev->type() == D::dev_type)
-                dev_list.push_back(static_cast<D*>(dev));
-        }
+    static small_vector<D*, FIND_ALL_INLINE> find_all() {
+        small_vector<D*, FIND_ALL_INLINE> dev_list;
+
+        for (auto dev = find(D::dev_type); dev; dev = load(dev->next_))
+            dev_list.push_back(static_cast<D*>(dev));
         return dev_list;
     }
 
-    static device* find(class_type type, std::string const& name) {
-        for (auto dev : devices) {
-            if (dev->type() == type && dev->name() == name)
+    static device* find(class_type type, char const* name) {
+        size_t len = strlen(name);
+        uint32_t hash = name_hash(name, len);
+
+        for (auto dev = load(name_buckets[hash % NAME_BUCKETS]); dev; dev = load(dev->hash_next_)) {
+            if (dev->name_hash_ == hash && dev->type() == type && dev->name_.size() == int(len) &&
+                !memcmp(dev->name_.c_str(), name, len))
                 return dev;
         }
         return nullptr;
     }
 
+    static device* find(class_type type, std::string const& name) {
+        return find(type, name.c_str());
+    }
+
     // TODO: create Device concept
+    template <typename D>
+    static D* find(char const* name) {
+        return static_cast<D*>(find(D::dev_type, name));
+    }
+
     template <typename D>
     static D* find(std::string const& name) {
-        for (auto dev : devices) {
-            if (dev->type() == D::dev_type && dev->name() == name)
-                return static_cast<D*>(dev);
+        return static_cast<D*>(find(D::dev_type, name.c_str()));
+    }
+
+ private:
+    static void unlink(device** p, device* dev, device* device::*link) {
+        for (; *p; p = &((*p)->*link)) {
+            if (*p == dev) {
+                publish(*p, dev->*link);
+                return;
+            }
         }
-        return nullptr;
     }
 };
 
+//
+// Cached lookup of a device of type @D, by name or the first one of its type. The lookup only
+// happens on first use and again after a device is unregistered, so drivers can keep a handle
+// instead of calling find() every time
+//
+template <typename D>
+class handle {
+ public:
+    constexpr handle(char const* name = nullptr) : name(name), dev(nullptr), gen(0) {}
+
+    D* get() {
+        unsigned g = manager::generation();
+        if (!dev || gen != g) {
+            dev = name ? manager::find<D>(name) : manager::find<D>();
+            gen = g;
+        }
+        return dev;
+    }
+
+    D* operator->() { return get(); }
+    explicit operator bool() { return get() != nullptr; }
+
+ private:
+    char const* name;
+    D* dev;
+    unsigned gen;
+};
+
 }  // namespace device
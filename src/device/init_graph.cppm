@@ -0,0 +1,124 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Device init graph: boards describe device initialization as a table of steps with the steps each
+ * one depends on. Steps needed to reach the shell run during board init in dependency order; steps
+ * marked as deferred run later in a thread, in parallel with the rest of the boot (and on another
+ * core when there is one). Each finished step is recorded as a boot phase (see lib::boottime).
+ */
+
+module;
+
+#include <errcodes.h>
+#include <stddef.h>
+#include <stdint.h>
+
+export module device.init_graph;
+
+import core.thread;
+import lib.boottime;
+import lib.exception;
+import lib.fmt;
+import std.memory;
+
+using core::thread::thread_t;
+using lib::exception;
+using lib::fmt::println;
+using std::unique_ptr;
+
+export namespace device {
+
+struct init_step {
+    char const* name;  // literal, it is also the boot phase name
+    void (*init)();
+    uint32_t deps = 0;  // mask of the steps (index in the table) that have to run first
+    bool deferred = false;  // not needed to reach the shell
+};
+
+class init_graph {
+ public:
+    static constexpr size_t MAX_STEPS = 32;
+
+    template <size_t N>
+    constexpr init_graph(init_step const (&steps)[N]) : steps(steps), n(N), done(0) {
+        static_assert(N <= MAX_STEPS, "init_graph: too many steps");
+    }
+
+    //
+    // run - Run the steps that are not deferred, they can't depend on deferred ones
+    //
+    void run() { run_steps(false); }
+
+    //
+    // run_deferred - Start a thread running the deferred steps, threads must be running
+    //
+    void run_deferred() {
+        worker = unique_ptr<thread_t>(new thread_t(
+            "dev_init", [](void* data) { static_cast<init_graph*>(data)->run_steps(true); },
+            this));
+    }
+
+    // wait for the deferred steps
+    void wait() {
+        if (worker)
+            worker->join();
+    }
+
+    bool is_done(size_t step) const {
+        return __atomic_load_n(&done, __ATOMIC_ACQUIRE) & (1U << step);
+    }
+
+ private:
+    // failures are reported here with the step name, deferred steps run in a thread and nobody
+    // may ever join it
+    static void run_step(init_step const& step) {
+        try {
+            step.init();
+        } catch (exception& e) {
+            println("device init: {} failed ({})", step.name, e.msg());
+            throw;
+        } catch (...) {
+            println("device init: {} failed", step.name);
+            throw;
+        }
+    }
+
+    void run_steps(bool deferred) {
+        for (;;) {
+            bool pending = false;
+            bool progress = false;
+
+            for (size_t i = 0; i != n; ++i) {
+                auto& step = steps[i];
+                uint32_t bit = 1U << i;
+                if (step.deferred != deferred || (done & bit))
+                    continue;
+                if ((step.deps & done) != step.deps) {
+                    pending = true;
+                    continue;
+                }
+
+                run_step(step);
+                __atomic_or_fetch(&done, bit, __ATOMIC_RELEASE);
+                lib::boottime::mark(step.name);
+                progress = true;
+            }
+
+            if (!pending)
+                return;
+            if (!progress)
+                throw exception("device init: unmet or circular dependencies", ERR_INVALID_STATE);
+        }
+    }
+
+    init_step const* steps;
+    size_t n;
+    uint32_t done;
+    unique_ptr<thread_t> worker;
+};
+
+}  // namespace device
@@ -15,6 +15,7 @@ import core.cpu;
 import std.string;
 import lib.reg;
 import lib.fmt;
+import lib.log;
 import lib.exception;
 
 using lib::exception;
@@ -25,7 +26,7 @@ using std::string;
 
 export namespace device {
 
-class gic : public intc {
+class gic final : public intc {
  public:
     struct platform_data {
         uintptr_t dbase;
@@ -192,6 +193,7 @@ void gic::isr() {
             break;
         }
 
+        lib::log::log("irq {}", irq);
         handler.handler(irq, handler.data);
     } while (0);
 
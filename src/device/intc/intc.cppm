@@ -61,3 +61,7 @@ concept Intc = requires(T t, unsigned irq, unsigned flags, unsigned mask, intc::
 };
 
 }  // namespace device
+
+// Boards that know their interrupt controller at build time can define it to send ipis calling the
+// driver directly. Without it (null) the registered controller is used
+export extern "C" [[gnu::weak]] void board_send_ipi(device::intc::ipi_target target, unsigned irq);
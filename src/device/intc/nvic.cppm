@@ -19,6 +19,7 @@ import std.string;
 import std.vector;
 import lib.reg;
 import lib.fmt;
+import lib.log;
 import lib.exception;
 
 using lib::exception;
@@ -32,7 +33,7 @@ constexpr unsigned EXT_INT_MAX = 32;
 
 export namespace device {
 
-class nvic : public intc {
+class nvic final : public intc {
  public:
     struct platform_data {
         // PPB_BASE
@@ -61,6 +62,7 @@ class nvic : public intc {
 
     static void default_handler() {
         unsigned irq = sysreg_read(ipsr);
+        lib::log::log("irq {}", irq);
         handlers[irq].func(irq, handlers[irq].data);
     }
 
@@ -55,7 +55,7 @@ struct event_arm : public timer::event {
 
 export namespace device {
 
-class timer_arm : public timer {
+class timer_arm final : public timer {
  public:
     struct platform_data {
         unsigned irq;
@@ -46,3 +46,8 @@ concept Timer = requires(T t, timer::callback cb, void* data, enum timer::type t
 };
 
 }  // namespace device
+
+// Boards that know their timer at build time can define it to arm @e calling the driver directly,
+// so sleeps and timers avoid a virtual call. Without it (null) the registered timer is used
+export extern "C" [[gnu::weak]] void board_timer_set(device::timer::event* e,
+                                                     lib::time::time_us_t period);
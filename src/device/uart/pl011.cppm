@@ -6,6 +6,8 @@
 
 module;
 
+#include <errcodes.h>
+#include <stddef.h>
 #include <stdint.h>
 
 export module device.uart.pl011;
@@ -16,41 +18,90 @@ import lib.reg;
 import device;
 import device.intc;
 import core.event;
+import core.thread;
+import lib.cpu;
+import lib.exception;
+import lib.lock;
 import lib.time;
+import std.memory;
 
 using core::event;
+using lib::exception;
+using lib::lock;
+using lib::slock_irqsafe;
 using lib::reg::reg32;
 using namespace lib::time;
 
-static event rx_evt;
-
 export namespace device {
 
-class pl011 : public uart {
+class pl011 final : public uart {
  public:
     struct platform_data {
         uintptr_t base;
         unsigned freq;
         unsigned baudrate;
         unsigned irq;
+        // size of the TX ring (power of 2), writers only wait for the ring instead of the fifo.
+        // 0 means writes poll the fifo
+        size_t tx_ring = 0;
     };
 
     pl011(std::string const& name, platform_data const& pdata)
-        : uart(name), base(pdata.base), freq(pdata.freq), baud(pdata.baudrate), irq(pdata.irq) {}
+        : uart(name),
+          base(pdata.base),
+          freq(pdata.freq),
+          baud(pdata.baudrate),
+          irq(pdata.irq),
+          tx_size(pdata.tx_ring) {}
 
     inline void init() override;
     inline void baudrate(unsigned baud) override;
     inline void putc(int c, bool wait = true) override;
     inline int getc(bool wait = true) override;
     inline void flush() override;
+    inline void write(char const* buf, size_t n) override;
+    inline size_t read(char* buf, size_t n, time_us_t timeout = INFINITE) override;
 
  private:
+    // smallest fifo depth among pl011 revisions
+    static constexpr size_t FIFO_SIZE = 16;
+    static constexpr size_t RX_RING_SIZE = 256;
+    static constexpr int TX_POLL_LOCK_TRIES = 1000;
+
     volatile uint32_t& reg(uint32_t offset) { return reg32(base + offset); }
     void isr();
+    bool polled();
+    size_t rx_pop(char* buf, size_t n);
+    size_t rx_poll(char* buf, size_t n, time_us_t timeout);
+    void tx_fill_fifo();
+    void tx_poll(char const* buf, size_t n);
+    void tx_queue(char const* buf, size_t n, bool wait);
+
     uintptr_t base;
     unsigned freq;
     unsigned baud;
     unsigned irq;
+
+    // TX ring, head and tail are free running indexes. Protected by @l, which also covers the
+    // read-modify-write of UART_IMSC
+    std::unique_ptr<uint8_t[]> tx_buf;
+    size_t tx_size;
+    size_t tx_head = 0;
+    size_t tx_tail = 0;
+    bool tx_active = false;  // TX interrupt enabled, the isr feeds the fifo from the ring
+    unsigned tx_waiters = 0;
+    event tx_evt;
+
+    // RX ring, filled by the isr. When it is full RX interrupts are masked (@rx_throttled) and
+    // chars stay in the fifo until the reader makes room
+    uint8_t rx_buf[RX_RING_SIZE];
+    size_t rx_head = 0;
+    size_t rx_tail = 0;
+    bool rx_throttled = false;
+    unsigned rx_waiters = 0;
+    event rx_evt;
+
+    lock l;
 };
 
 }  // namespace device
@@ -88,6 +139,7 @@ enum UART_CR_bits : uint32_t {
 
 enum UART_INT_bits : uint32_t {
     UART_RXI        = 1U << 4,
+    UART_TXI        = 1U << 5,
     UART_RTI        = 1U << 6,
 };
 
@@ -105,10 +157,19 @@ void pl011::init() {
     // enable uart
     reg(UART_CR) = UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE;
 
+    if (tx_size) {
+        // round down to a power of 2 so indexes can be masked
+        tx_size = size_t(1) << (sizeof(long) * 8 - 1 - __builtin_clzl(tx_size));
+        tx_buf = std::unique_ptr<uint8_t[]>(new uint8_t[tx_size]);
+    }
+
     auto intc = manager::find<::device::intc>();
     intc->request_irq(
         irq, intc::FLAG_START_ENABLED,
         [](unsigned, void* data) { reinterpret_cast<pl011*>(data)->isr(); }, this);
+
+    // from now on the isr collects RX chars in the ring
+    lib::lock_irqsafe_for(l, [this] { reg(UART_IMSC) |= UART_RXI | UART_RTI; });
 }
 
 void pl011::baudrate(unsigned baudrate) {
@@ -124,41 +185,226 @@ void pl011::baudrate(unsigned baudrate) {
 }
 
 void pl011::putc(int c, bool wait) {
-    if ((reg(UART_FR) & UART_FR_TXFF) && !wait)
+    char ch = c;
+
+    if (tx_buf && !polled()) {
+        tx_queue(&ch, 1, wait);
         return;
+    }
 
-    // wait for room in tx fifo
-    // TODO: add spin lock
-    while (reg(UART_FR) & UART_FR_TXFF) {}
+    if ((reg(UART_FR) & UART_FR_TXFF) && !wait)
+        return;
 
-    reg(UART_DR) = c;
+    tx_poll(&ch, 1);
 }
 
 int pl011::getc(bool wait) {
-    if (!(reg(UART_FR) & UART_FR_RXEE)) {
-        return reg(UART_DR);
-    }
-
-    if (!wait)
+    char c;
+    if (!read(&c, 1, wait ? INFINITE : 0))
         return 0;
+    return c;
+}
 
-    do {
-        // enbable RX interrupt
-        reg(UART_IMSC) |= UART_RXI | UART_RTI;
+size_t pl011::read(char* buf, size_t n, time_us_t timeout) {
+    if (!n)
+        return 0;
 
-        rx_evt.wait_for_signal();
-    } while (reg(UART_FR) & UART_FR_RXEE);
+    if (polled())
+        return rx_poll(buf, n, timeout);
+
+    uint64_t deadline = time_us_t(now()).count() + timeout.count();
+    for (;;) {
+        {
+            slock_irqsafe guard(l);
+            size_t len = rx_pop(buf, n);
+            if (len || !timeout.count())
+                return len;
+            rx_waiters++;
+        }
+
+        try {
+            rx_evt.wait_for_signal(timeout);
+        } catch (exception& e) {
+            if (e.error() != ERR_TIMED_OUT)
+                throw;
+            slock_irqsafe guard(l);
+            if (rx_waiters)
+                rx_waiters--;
+            return rx_pop(buf, n);
+        }
+
+        // a wakeup without chars (a stale signal) must not restart the whole timeout
+        if (timeout.count() != INFINITE) {
+            uint64_t t = time_us_t(now()).count();
+            timeout = t < deadline ? deadline - t : 0;
+        }
+    }
+}
 
-    return reg(UART_DR);
+void pl011::write(char const* buf, size_t n) {
+    if (!tx_buf || polled())
+        tx_poll(buf, n);
+    else
+        tx_queue(buf, n, true);
 }
 
 void pl011::flush() {
+    if (tx_buf && !polled()) {
+        for (;;) {
+            {
+                slock_irqsafe guard(l);
+                if (tx_tail == tx_head)
+                    break;
+                tx_waiters++;
+            }
+            tx_evt.wait_for_signal();
+        }
+    } else if (tx_buf) {
+        // drain the ring
+        tx_poll(nullptr, 0);
+    }
+
     while (!(reg(UART_FR) & UART_FR_TXFE)) {}
 }
 
+// The rings can only be used when the uart interrupt can be taken and there is a thread to wait for
+// it. Early boot, interrupt handlers and crash paths (interrupts masked) go to the fifo directly
+bool pl011::polled() {
+    return lib::cpu::irq_masked() || !core::thread::current();
+}
+
+// copy up to @n chars from the RX ring, @l must be held
+size_t pl011::rx_pop(char* buf, size_t n) {
+    size_t len = 0;
+    while (len != n && rx_tail != rx_head)
+        buf[len++] = rx_buf[rx_tail++ % RX_RING_SIZE];
+
+    if (len && rx_throttled) {
+        rx_throttled = false;
+        reg(UART_IMSC) |= UART_RXI | UART_RTI;
+    }
+    return len;
+}
+
+size_t pl011::rx_poll(char* buf, size_t n, time_us_t timeout) {
+    uint64_t deadline = time_us_t(now()).count() + timeout.count();
+
+    for (;;) {
+        size_t len;
+        {
+            slock_irqsafe guard(l);
+            // chars already in the ring go first
+            len = rx_pop(buf, n);
+            while (len != n && !(reg(UART_FR) & UART_FR_RXEE))
+                buf[len++] = reg(UART_DR);
+        }
+        if (len || !timeout.count())
+            return len;
+        if (timeout.count() != INFINITE && time_us_t(now()).count() >= deadline)
+            return 0;
+    }
+}
+
+// move chars from the ring to the fifo until any of them is full/empty, @l must be held
+void pl011::tx_fill_fifo() {
+    while (tx_tail != tx_head && !(reg(UART_FR) & UART_FR_TXFF))
+        reg(UART_DR) = tx_buf[tx_tail++ & (tx_size - 1)];
+}
+
+// Polled writes also serve crash paths, which can run while @l is held by the code they interrupted
+// (or by a cpu that will never release it). Waiting on @l there would hang the crash output, so
+// after a bounded number of tries the chars go to the fifo without it and the ring is left alone
+void pl011::tx_poll(char const* buf, size_t n) {
+    auto flags = lib::cpu::save_and_disable_irq();
+    bool locked = false;
+    for (int i = 0; i < TX_POLL_LOCK_TRIES && !locked; ++i)
+        locked = l.try_acquire();
+
+    // chars still in the ring go first to keep the output in order
+    while (locked && tx_tail != tx_head) {
+        while (reg(UART_FR) & UART_FR_TXFF) {}
+        tx_fill_fifo();
+    }
+
+    while (n) {
+        // once the fifo is empty a whole burst fits, no need to check for room on every char
+        while (!(reg(UART_FR) & UART_FR_TXFE)) {}
+
+        size_t burst = n < FIFO_SIZE ? n : FIFO_SIZE;
+        n -= burst;
+        while (burst--)
+            reg(UART_DR) = *buf++;
+    }
+
+    if (locked)
+        l.release();
+    lib::cpu::restore_irq(flags);
+}
+
+void pl011::tx_queue(char const* buf, size_t n, bool wait) {
+    while (n) {
+        {
+            slock_irqsafe guard(l);
+
+            size_t room = tx_size - (tx_head - tx_tail);
+            size_t len = n < room ? n : room;
+            n -= len;
+            while (len--)
+                tx_buf[tx_head++ & (tx_size - 1)] = *buf++;
+
+            // the TX interrupt only triggers when the fifo level goes down through the trigger
+            // level, an idle transmitter has to be started by filling the fifo here
+            if (!tx_active) {
+                tx_fill_fifo();
+                if (tx_tail != tx_head) {
+                    tx_active = true;
+                    reg(UART_IMSC) |= UART_TXI;
+                }
+            }
+
+            if (!n || !wait)
+                return;
+
+            // ring is full, wait for the isr to make room
+            tx_waiters++;
+        }
+        tx_evt.wait_for_signal();
+    }
+}
+
 void pl011::isr() {
-    reg(UART_IMSC) &= ~(UART_RXI | UART_RTI);
-    rx_evt.signal();
+    slock_irqsafe guard(l);
+    uint32_t mis = reg(UART_MIS);
+
+    if (mis & UART_TXI) {
+        // clear it before refilling, otherwise the fifo could go down through the trigger level
+        // again after filling it and that interrupt would be lost
+        reg(UART_ICR) = UART_TXI;
+        tx_fill_fifo();
+        if (tx_tail == tx_head) {
+            tx_active = false;
+            reg(UART_IMSC) &= ~UART_TXI;
+        }
+
+        for (; tx_waiters; tx_waiters--)
+            tx_evt.signal();
+    }
+
+    if (mis & (UART_RXI | UART_RTI)) {
+        // drain the whole fifo, the reader wakes up once per trigger level or RX timeout
+        while (!(reg(UART_FR) & UART_FR_RXEE)) {
+            if (rx_head - rx_tail == RX_RING_SIZE) {
+                rx_throttled = true;
+                reg(UART_IMSC) &= ~(UART_RXI | UART_RTI);
+                break;
+            }
+            rx_buf[rx_head++ % RX_RING_SIZE] = reg(UART_DR);
+        }
+        reg(UART_ICR) = UART_RXI | UART_RTI;
+
+        for (; rx_waiters; rx_waiters--)
+            rx_evt.signal();
+    }
 }
 
 }  // namespace device
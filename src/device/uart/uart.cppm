@@ -4,9 +4,14 @@
  * Copyright (c) 2021 Fernando Lugo <lugo.fernando@gmail.com>
  */
 
+module;
+
+#include <stddef.h>
+
 export module device.uart;
 
 export import device;
+export import lib.time;
 import std.string;
 
 export namespace device {
@@ -23,6 +28,28 @@ class uart : public device {
     virtual void putc(int c, bool wait = true) = 0;
     virtual int getc(bool wait = true) = 0;
     virtual void flush() = 0;
+
+    // write @n chars, uarts with a fifo should override it to fill the fifo in bursts
+    virtual void write(char const* buf, size_t n) {
+        for (size_t i = 0; i != n; ++i)
+            putc(buf[i]);
+    }
+
+    //
+    // read - Read up to @n chars
+    //
+    // Blocks until at least one char is available or @timeout expires, a 0 timeout never blocks.
+    // Returns the number of chars read. The default implementation can't time out and stops at the
+    // first 0 from getc(), uarts with a fifo should override it
+    //
+    virtual size_t read(char* buf, size_t n, lib::time::time_us_t timeout = lib::time::INFINITE) {
+        size_t i = 0;
+        if (n && timeout.count())
+            buf[i++] = getc(true);
+        for (int c; i != n && (c = getc(false)); )
+            buf[i++] = c;
+        return i;
+    }
 };
 
 // uart device concept
@@ -12,6 +12,7 @@ module;
 #include <string.h>
 
 export module lib.allocator.simple;
+export import lib.allocator.stats;
 import lib.lock;
 
 export namespace lib::allocator {
@@ -65,6 +66,9 @@ class simple {
     void* alloc(size_t size, size_t align) noexcept;
     void* realloc(void* p, size_t size, size_t align) noexcept;
     void free(void* p) noexcept;
+    stats get_stats() noexcept;
+    void reset_peak() noexcept;
+    void dump() noexcept;
 
  private:
     struct chunks {
@@ -100,13 +104,19 @@ class simple {
     };
 
     chunk* find_free(size_t size, size_t align) noexcept;
-    void dump() noexcept;
 
     uint8_t* const start;
     uint8_t* const end;
     chunk* free_chunk;
     chunks chunks;
     lock lock;
+
+    // running counters, protected by lock
+    size_t used = 0;
+    size_t peak = 0;
+    size_t alloc_count = 0;
+    size_t free_count = 0;
+    size_t fail_count = 0;
 };
 
 }  // namespace lib::allocator
@@ -154,8 +164,10 @@ void* simple::alloc(size_t const size, size_t align) noexcept {
 
     slock_irqsafe guard{lock};
     chunk* c = find_free(size, align);
-    if (!c)
+    if (!c) {
+        fail_count++;
         return nullptr;
+    }
 
     size_t offset = align_offset(c->mem_ptr(), align);
 
@@ -173,6 +185,12 @@ void* simple::alloc(size_t const size, size_t align) noexcept {
     }
 
     c->state = USED;
+
+    used += c->size;
+    if (used > peak)
+        peak = used;
+    alloc_count++;
+
     return c->mem_ptr();
 }
 
@@ -186,10 +204,13 @@ void simple::free(void* p) noexcept {
         return;
     }
 
+    slock_irqsafe guard{lock};
     if (c->state == FREE) {
         printf("free: pointer already freed %p\n", c);
     } else if (c->state == USED) {
         c->state = FREE;
+        used -= c->size;
+        free_count++;
     } else {
         printf("free: invalid chunk state %x\n", c->state);
     }
@@ -205,12 +226,53 @@ void* simple::realloc(void* p, size_t size, size_t align) noexcept {
         return nullptr;
     }
 
-    // simple copy
+    if (c->state == USED && !(reinterpret_cast<uintptr_t>(p) & (align - 1))) {
+        slock_irqsafe guard{lock};
+
+        auto new_size = align_up(size + CHUNK_SIZE, MIN_ALIGNMENT) - CHUNK_SIZE;
+        if (new_size <= c->size) {
+            // shrink in place, the tail goes back to the heap when it can hold a chunk
+            size_t old_size = c->size;
+            if (auto nc = c->split_at(new_size)) {
+                nc->state = FREE;
+                free_chunk = nc;
+                used -= old_size - c->size;
+            }
+            return p;
+        }
+
+        // grow in place by merging the free chunks that follow
+        size_t avail = c->size;
+        for (auto n = c->next(); n < chunks.last && n->state == FREE && avail < new_size;
+             n = n->next())
+            avail += n->size + CHUNK_SIZE;
+
+        if (avail >= new_size) {
+            size_t old_size = c->size;
+            c->size = avail;
+
+            auto nc = c->split_at(new_size);
+            if (nc) {
+                nc->state = FREE;
+                free_chunk = nc;
+            } else if (free_chunk > c && free_chunk < c->next()) {
+                // cached free chunk was merged
+                free_chunk = chunks.first;
+            }
+
+            used += c->size - old_size;
+            if (used > peak)
+                peak = used;
+            return p;
+        }
+    }
+
+    // move to a new chunk
     void* ptr = alloc(size, align);
     if (!ptr)
         return nullptr;
 
-    memcpy(ptr, p, c->size);
+    memcpy(ptr, p, c->size < size ? c->size : size);
     free(p);
 
     return ptr;
@@ -241,7 +303,50 @@ chunk* simple::find_free(size_t size, size_t align) noexcept {
     return nullptr;
 }
 
+stats simple::get_stats() noexcept {
+    stats s{};
+
+    auto account_free = [&s](size_t size) {
+        s.free_bytes += size;
+        s.free_blocks++;
+        if (size > s.largest_free)
+            s.largest_free = size;
+        s.hist[stats_hist_bucket(size)]++;
+    };
+
+    slock_irqsafe guard{lock};
+    s.total = end - start;
+    s.used = used;
+    s.peak = peak;
+    s.alloc_count = alloc_count;
+    s.free_count = free_count;
+    s.fail_count = fail_count;
+
+    // adjacent free chunks are only merged on demand, so account them as a single block
+    size_t run = 0;
+    bool in_run = false;
+    for (auto& c : chunks) {
+        if (c.state == FREE) {
+            run = in_run ? run + c.size + CHUNK_SIZE : c.size;
+            in_run = true;
+        } else if (in_run) {
+            account_free(run);
+            in_run = false;
+        }
+    }
+    if (in_run)
+        account_free(run);
+
+    return s;
+}
+
+void simple::reset_peak() noexcept {
+    slock_irqsafe guard{lock};
+    peak = used;
+}
+
 void simple::dump() noexcept {
+    slock_irqsafe guard{lock};
     for (auto& c : chunks) {
         printf("chunk=%p state = %x, size %u\n", &c, c.state, c.size);
     }
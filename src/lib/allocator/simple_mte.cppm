@@ -12,9 +12,18 @@ module;
 #include <string.h>
 
 export module lib.allocator.simple;
+export import lib.allocator.stats;
 import lib.lock;
 import arch.aarch64.mte;
 
+#ifndef CONFIG_AARCH64_MTE_SAMPLE_RATE
+#define CONFIG_AARCH64_MTE_SAMPLE_RATE 1
+#endif
+
+#ifndef CONFIG_AARCH64_MTE_SAMPLE_MAX_SIZE
+#define CONFIG_AARCH64_MTE_SAMPLE_MAX_SIZE 0
+#endif
+
 export namespace lib::allocator {
 
 enum chunk_state : uint32_t {
@@ -66,6 +75,9 @@ class simple {
     void* alloc(size_t size, size_t align) noexcept;
     void* realloc(void* p, size_t size, size_t align) noexcept;
     void free(void* p) noexcept;
+    stats get_stats() noexcept;
+    void reset_peak() noexcept;
+    void dump() noexcept;
 
  private:
     struct chunks {
@@ -103,15 +115,40 @@ class simple {
     void* alloc_notag(size_t size, size_t align) noexcept;
 
     chunk* find_free(size_t size, size_t align) noexcept;
-    void dump() noexcept;
 
     uint8_t* const start;
     uint8_t* const end;
     chunk* free_chunk;
     chunks chunks;
     lock lock;
+
+    // running counters, protected by lock
+    size_t used = 0;
+    size_t peak = 0;
+    size_t alloc_count = 0;
+    size_t free_count = 0;
+    size_t fail_count = 0;
+};
+
+namespace mte {
+
+//
+// Tagging every allocation costs time proportional to its size, sampling tags only some of them so
+// MTE can stay enabled with low overhead. Untagged allocations use tag 0, which is what free memory
+// is tagged with, so they need no tagging at all.
+//
+struct sampling {
+    unsigned rate;    // tag 1 in @rate allocations, 1 tags all of them, 0 disables tagging
+    size_t max_size;  // only allocations up to @max_size bytes are tagged, 0 means no limit
+    size_t tagged;    // number of tagged allocations
+    size_t untagged;  // number of allocations skipped
 };
 
+void set_sampling(unsigned rate, size_t max_size) noexcept;
+sampling get_sampling() noexcept;
+
+}  // namespace mte
+
 }  // namespace lib::allocator
 
 // implementation
@@ -132,6 +169,30 @@ size_t align_offset(void* ptr, size_t align) {
     return ((ptr_val + mask) & ~mask) - ptr_val;
 }
 
+// regions smaller than this are tagged with st2g only, dc gzva is not worth the alignment work
+constexpr size_t BULK_TAG_MIN = 256;
+
+// dc gzva block size, 0 when it can't be used
+size_t gzva_block_size;
+
+unsigned sample_rate = CONFIG_AARCH64_MTE_SAMPLE_RATE;
+size_t sample_max_size = CONFIG_AARCH64_MTE_SAMPLE_MAX_SIZE;
+size_t sample_counter;
+size_t tagged_count;
+size_t untagged_count;
+
+bool sample(size_t size) {
+    unsigned rate = __atomic_load_n(&sample_rate, __ATOMIC_RELAXED);
+    size_t max_size = __atomic_load_n(&sample_max_size, __ATOMIC_RELAXED);
+
+    bool tag = rate && (!max_size || size <= max_size);
+    if (tag && rate > 1)
+        tag = __atomic_fetch_add(&sample_counter, 1, __ATOMIC_RELAXED) % rate == 0;
+
+    __atomic_fetch_add(tag ? &tagged_count : &untagged_count, 1, __ATOMIC_RELAXED);
+    return tag;
+}
+
 }  // namespace
 
 namespace lib::allocator {
@@ -145,6 +206,10 @@ void simple::init() noexcept {
     free_chunk = chunks.first;
     free_chunk->state = FREE;
     free_chunk->size = end - start - CHUNK_SIZE;
+
+    // st2g is used to align the address to the block size, so it has to be a multiple of 32
+    auto bs = aarch64::dczva_block_size();
+    gzva_block_size = bs >= 32 ? bs : 0;
 }
 
 void* simple::alloc_notag(size_t size, size_t align) noexcept {
@@ -160,8 +225,10 @@ void* simple::alloc_notag(size_t size, size_t align) noexcept {
 
     slock_irqsafe guard{lock};
     chunk* c = find_free(size, align);
-    if (!c)
+    if (!c) {
+        fail_count++;
         return nullptr;
+    }
 
     size_t offset = align_offset(c->mem_ptr(), align);
 
@@ -179,27 +246,57 @@ void* simple::alloc_notag(size_t size, size_t align) noexcept {
     }
 
     c->state = USED;
+
+    used += c->size;
+    if (used > peak)
+        peak = used;
+    alloc_count++;
+
     return c->mem_ptr();
 }
 
+// set the tag of the granules in [@addr, @addr + @size) to the tag of @addr. Granules are tagged in
+// pairs with st2g and big regions are tagged a whole dc zva block at a time, which also zeroes it.
+// Only granules fully inside the region are zeroed, a trailing partial granule can hold the header
+// of the next chunk (chunk sizes are 8 mod 16) so it only gets its tag changed
+static void set_tags(uintptr_t addr, size_t size) {
+    uintptr_t end = addr + align_up(size, 16);
+    uintptr_t zero_end = addr + (size & ~size_t(15));
+
+    if ((addr & 16) && addr < end) {
+        aarch64::stg(addr);
+        addr += 16;
+    }
+
+    size_t bs = gzva_block_size;
+    if (bs && size >= BULK_TAG_MIN && zero_end - addr >= 2 * bs) {
+        for (; addr & (bs - 1); addr += 32)
+            aarch64::st2g(addr);
+        for (; zero_end - addr >= bs; addr += bs)
+            aarch64::dc_gzva(addr);
+    }
+
+    for (; end - addr >= 32; addr += 32)
+        aarch64::st2g(addr);
+
+    if (addr < end)
+        aarch64::stg(addr);
+}
+
 static void* tag_region(void* ptr, size_t size, bool random = false) {
     uintptr_t addr = (uintptr_t)ptr;
 
-    if (random) {
+    if (random)
         addr = aarch64::irg(addr);
-        ptr = (void *)addr;
-    }
 
-    for (size_t i = 0; i < size; i += 16, addr += 16) {
-        aarch64::stg(addr);
-    }
+    set_tags(addr, size);
 
-    return ptr;
+    return (void*)addr;
 }
 
 void* simple::alloc(size_t size, size_t align) noexcept {
     auto ptr = simple::alloc_notag(size, align);
-    if (ptr) {
+    if (ptr && sample(size)) {
         ptr = tag_region(ptr, size, true);
     }
     return ptr;
@@ -215,6 +312,7 @@ void simple::free(void* p) noexcept {
     if (!p)
         return;
 
+    bool tagged = aarch64::get_tag((uintptr_t)p);
     p = untag_addr(p);
 
     chunk* c = chunk::from_mem_ptr(p);
@@ -223,13 +321,17 @@ void simple::free(void* p) noexcept {
         return;
     }
 
-    // tag region with untag address
-    tag_region(p, c->size);
+    // tag region with untag address, memory of untagged allocations already has tag 0
+    if (tagged)
+        tag_region(p, c->size);
 
+    slock_irqsafe guard{lock};
     if (c->state == FREE) {
         printf("free: pointer already freed %p\n", c);
     } else if (c->state == USED) {
         c->state = FREE;
+        used -= c->size;
+        free_count++;
     } else {
         printf("free: invalid chunk state %x\n", c->state);
     }
@@ -239,18 +341,21 @@ void* simple::realloc(void* p, size_t size, size_t align) noexcept {
     if (!p)
         return alloc(size, align);
 
-    chunk* c = chunk::from_mem_ptr(p);
+    chunk* c = chunk::from_mem_ptr(untag_addr(p));
     if (c < chunks.first || c >= chunks.last) {
         printf("free: invalid pointer %p\n", c);
         return nullptr;
     }
 
-    // simple copy
+    // simple copy, always to a new chunk so the new allocation gets its own tag
     void* ptr = alloc(size, align);
     if (!ptr)
         return nullptr;
 
-    memcpy(ptr, p, c->size);
+    // only the whole granules of the chunk have the tag of @p, the last one is shared with the
+    // header of the next chunk
+    size_t old_size = c->size & ~size_t(15);
+    memcpy(ptr, p, old_size < size ? old_size : size);
     free(p);
 
     return ptr;
@@ -281,10 +386,71 @@ chunk* simple::find_free(size_t size, size_t align) noexcept {
     return nullptr;
 }
 
+stats simple::get_stats() noexcept {
+    stats s{};
+
+    auto account_free = [&s](size_t size) {
+        s.free_bytes += size;
+        s.free_blocks++;
+        if (size > s.largest_free)
+            s.largest_free = size;
+        s.hist[stats_hist_bucket(size)]++;
+    };
+
+    slock_irqsafe guard{lock};
+    s.total = end - start;
+    s.used = used;
+    s.peak = peak;
+    s.alloc_count = alloc_count;
+    s.free_count = free_count;
+    s.fail_count = fail_count;
+
+    // adjacent free chunks are only merged on demand, so account them as a single block
+    size_t run = 0;
+    bool in_run = false;
+    for (auto& c : chunks) {
+        if (c.state == FREE) {
+            run = in_run ? run + c.size + CHUNK_SIZE : c.size;
+            in_run = true;
+        } else if (in_run) {
+            account_free(run);
+            in_run = false;
+        }
+    }
+    if (in_run)
+        account_free(run);
+
+    return s;
+}
+
+void simple::reset_peak() noexcept {
+    slock_irqsafe guard{lock};
+    peak = used;
+}
+
 void simple::dump() noexcept {
+    slock_irqsafe guard{lock};
     for (auto& c : chunks) {
         printf("chunk=%p state = %x, size %u\n", &c, c.state, c.size);
     }
 }
 
+namespace mte {
+
+void set_sampling(unsigned rate, size_t max_size) noexcept {
+    __atomic_store_n(&sample_rate, rate, __ATOMIC_RELAXED);
+    __atomic_store_n(&sample_max_size, max_size, __ATOMIC_RELAXED);
+}
+
+sampling get_sampling() noexcept {
+    return {
+        __atomic_load_n(&sample_rate, __ATOMIC_RELAXED),
+        __atomic_load_n(&sample_max_size, __ATOMIC_RELAXED),
+        __atomic_load_n(&tagged_count, __ATOMIC_RELAXED),
+        __atomic_load_n(&untagged_count, __ATOMIC_RELAXED),
+    };
+}
+
+}  // namespace mte
+
 }  // namespace lib::allocator
@@ -0,0 +1,47 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+module;
+
+#include <stddef.h>
+
+export module lib.allocator.stats;
+
+export namespace lib::allocator {
+
+// free block histogram uses power of 2 buckets, bucket 0 holds blocks smaller than
+// 1 << STATS_HIST_SHIFT and the last bucket holds everything bigger than the previous one
+constexpr unsigned STATS_HIST_SHIFT = 5;
+constexpr unsigned STATS_HIST_BUCKETS = 16;
+
+struct stats {
+    size_t total;         // total heap size in bytes, including chunk headers
+    size_t used;          // bytes currently allocated (payload)
+    size_t peak;          // maximum value ever reached by used
+    size_t alloc_count;   // number of successful allocations
+    size_t free_count;    // number of frees
+    size_t fail_count;    // number of failed allocations
+    size_t free_bytes;    // bytes available in free blocks
+    size_t free_blocks;   // number of free blocks (adjacent free chunks count as one)
+    size_t largest_free;  // biggest allocation that can be satisfied right now
+    size_t hist[STATS_HIST_BUCKETS];
+};
+
+constexpr unsigned stats_hist_bucket(size_t size) {
+    unsigned b = 0;
+    for (size >>= STATS_HIST_SHIFT; size && b < STATS_HIST_BUCKETS - 1; size >>= 1)
+        b++;
+    return b;
+}
+
+// returns fragmentation in percentage, 0 means all free memory is in a single block
+constexpr unsigned stats_fragmentation(stats const& s) {
+    if (!s.free_bytes)
+        return 0;
+    return 100 - s.largest_free * 100 / s.free_bytes;
+}
+
+}  // namespace lib::allocator
@@ -0,0 +1,200 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Monotonic (bump) allocator. Memory is taken from a caller provided buffer (usually on the stack)
+ * by just moving a pointer, individual allocations are not freed (except the most recent one) and
+ * everything is released at once by reset() or when the arena is destroyed. When the buffer is
+ * exhausted more blocks are taken from the global heap, so using a buffer big enough for the common
+ * case means zero global heap allocations.
+ *
+ * The arena is not thread safe, it is meant to be used by a single thread for short lived work,
+ * e.g. parsing a command line. arena_allocator<T> makes it usable with std containers.
+ */
+
+module;
+
+#include <errcodes.h>
+#include <stddef.h>
+#include <stdint.h>
+
+export module lib.arena;
+
+export import std.string;
+export import std.vector;
+import lib.exception;
+import lib.heap;
+
+export namespace lib {
+
+class arena {
+ public:
+    arena(void* buf, size_t size)
+        : buf{static_cast<uint8_t*>(buf)},
+          buf_size{size},
+          block_size{size < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : size} {
+        reset();
+    }
+
+    // arena without initial buffer, memory comes from the heap in @block_size chunks. The first
+    // block is kept by reset() so that it can be reused without going to the heap again
+    explicit arena(size_t block_size = MIN_BLOCK_SIZE) : arena(nullptr, block_size) {}
+
+    ~arena() { release(nullptr); }
+
+    arena(arena const&) = delete;
+    arena& operator=(arena const&) = delete;
+
+    //
+    // alloc - Allocate @size bytes aligned to @align
+    //
+    // Returns nullptr if there is no space left and the heap is full too. Zero bytes allocations
+    // get a valid pointer too, a heap arena takes its first block for them
+    //
+    void* alloc(size_t size, size_t align = alignof(max_align_t)) {
+        auto p = align_up(cur, align);
+        if (!p || p > end || size > static_cast<size_t>(end - p)) {
+            if (!grow(size + align))
+                return nullptr;
+            p = align_up(cur, align);
+        }
+
+        used_bytes += p + size - cur;
+        if (used_bytes > peak_bytes)
+            peak_bytes = used_bytes;
+        cur = p + size;
+        return p;
+    }
+
+    //
+    // free - Give memory back to the arena
+    //
+    // Only the most recent allocation can be given back (e.g. growing a container), any other
+    // pointer is ignored and the memory is available again only after reset()
+    //
+    void free(void* p, size_t size) {
+        auto ptr = static_cast<uint8_t*>(p);
+        if (ptr + size == cur) {
+            used_bytes -= size;
+            cur = ptr;
+        }
+    }
+
+    //
+    // reset - Release all allocations at once
+    //
+    // Heap blocks are freed, the initial buffer (or the first heap block) is used again
+    //
+    void reset() {
+        if (buf) {
+            release(nullptr);
+            cur = buf;
+            end = buf + buf_size;
+        } else {
+            // keep the oldest block, it is the last one in the list
+            block* first = blocks;
+            while (first && first->next)
+                first = first->next;
+            release(first);
+            cur = first ? first->data() : nullptr;
+            end = first ? first->data() + first->size : nullptr;
+        }
+        used_bytes = 0;
+    }
+
+    size_t used() const { return used_bytes; }
+    size_t peak() const { return peak_bytes; }
+
+ private:
+    static constexpr size_t MIN_BLOCK_SIZE = 256;
+
+    struct block {
+        block* next;
+        size_t size;
+        uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+    };
+
+    uint8_t* buf;       // initial buffer
+    size_t buf_size;    // initial buffer size
+    size_t block_size;  // minimum size of heap blocks
+    block* blocks = nullptr;  // heap blocks, newest first
+    uint8_t* cur;
+    uint8_t* end;
+    size_t used_bytes;
+    size_t peak_bytes = 0;
+
+    static uint8_t* align_up(uint8_t* p, size_t align) {
+        auto v = reinterpret_cast<uintptr_t>(p);
+        return reinterpret_cast<uint8_t*>((v + align - 1) & ~(align - 1));
+    }
+
+    bool grow(size_t size) {
+        size_t n = size < block_size ? block_size : size;
+        auto b = static_cast<block*>(heap::alloc(sizeof(block) + n, alignof(max_align_t)));
+        if (!b)
+            return false;
+
+        b->next = blocks;
+        b->size = n;
+        blocks = b;
+        cur = b->data();
+        end = cur + n;
+        return true;
+    }
+
+    // free all heap blocks newer than @keep
+    void release(block* keep) {
+        while (blocks != keep) {
+            block* b = blocks;
+            blocks = b->next;
+            heap::free(b);
+        }
+    }
+};
+
+//
+// Allocator for std containers backed by an arena. Containers using it must not outlive the arena
+//
+template <typename T>
+class arena_allocator {
+ public:
+    using value_type = T;
+
+    arena_allocator(arena& a) noexcept : a(&a) {}
+    template <typename U>
+    arena_allocator(arena_allocator<U> const& other) noexcept : a(other.get_arena()) {}
+
+    [[nodiscard]] T* allocate(size_t n) {
+        void* p = a->alloc(n * sizeof(T), alignof(T));
+        if (!p)
+            throw exception("arena alloc failed", ERR_NO_MEMORY);
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t n) noexcept { a->free(p, n * sizeof(T)); }
+
+    arena* get_arena() const noexcept { return a; }
+
+ private:
+    arena* a;
+};
+
+template <typename T, typename U>
+bool operator==(arena_allocator<T> const& a, arena_allocator<U> const& b) noexcept {
+    return a.get_arena() == b.get_arena();
+}
+
+template <typename T, typename U>
+bool operator!=(arena_allocator<T> const& a, arena_allocator<U> const& b) noexcept {
+    return !(a == b);
+}
+
+using arena_string = std::basic_string<char, arena_allocator<char>>;
+
+template <typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+}  // namespace lib
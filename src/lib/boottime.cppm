@@ -0,0 +1,78 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Boot phases timestamps
+ *
+ * mark() records the time a boot phase ends, it is usable from reset (no heap, no threads) and from
+ * any core. Timestamps come from lib::timestamp, so they count from reset on platforms where the
+ * counter starts there; phases marked before the counter runs show up as 0.
+ */
+
+module;
+
+#include <stddef.h>
+#include <stdint.h>
+
+export module lib.boottime;
+
+import lib.fmt;
+import lib.timestamp;
+
+using lib::fmt::println;
+
+namespace lib::boottime {
+
+constexpr size_t MAX_PHASES = 32;
+
+struct phase {
+    char const* name;
+    uint64_t ticks;
+};
+
+static phase phases[MAX_PHASES];
+static size_t count;
+
+}  // namespace lib::boottime
+
+export namespace lib::boottime {
+
+//
+// mark - Record the end of phase @name, @name must be a literal. Phases over MAX_PHASES are dropped
+//
+void mark(char const* name) {
+    auto ticks = timestamp::ticks();
+    size_t i = __atomic_fetch_add(&count, 1, __ATOMIC_RELAXED);
+    if (i >= MAX_PHASES)
+        return;
+
+    phases[i].ticks = ticks;
+    __atomic_store_n(&phases[i].name, name, __ATOMIC_RELEASE);
+}
+
+//
+// dump - Print the phases with their time since reset and since the previous phase (in us)
+//
+void dump() {
+    size_t n = __atomic_load_n(&count, __ATOMIC_RELAXED);
+    if (n > MAX_PHASES)
+        n = MAX_PHASES;
+
+    println("{:>10} {:>10}  phase", "time", "delta");
+    uint64_t prev = 0;
+    for (size_t i = 0; i != n; ++i) {
+        auto name = __atomic_load_n(&phases[i].name, __ATOMIC_ACQUIRE);
+        if (!name)
+            continue;
+
+        auto us = timestamp::ticks_to_us(phases[i].ticks);
+        // phases marked by other cores can be slightly out of order
+        println("{:>10} {:>10}  {}", us, us > prev ? us - prev : 0, name);
+        prev = us;
+    }
+}
+
+}  // namespace lib::boottime
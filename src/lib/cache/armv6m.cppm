@@ -0,0 +1,45 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+module;
+
+#include <stddef.h>
+
+export module lib.cache.arch;
+
+// armv6-m cores have no caches, range operations are only barriers so memory writes are done
+// (and not moved by the compiler) before a DMA transfer is started
+
+export namespace lib::cache {
+
+// no lines, but keep DMA buffers word aligned
+constexpr size_t dcache_line() {
+    return 4;
+}
+
+constexpr size_t icache_line() {
+    return 4;
+}
+
+void clean(void const*, size_t) {
+    asm volatile("dsb" ::: "memory");
+}
+
+void invalidate(void*, size_t) {
+    asm volatile("dsb" ::: "memory");
+}
+
+void clean_invalidate(void const*, size_t) {
+    asm volatile("dsb" ::: "memory");
+}
+
+void clean_all() {}
+void clean_invalidate_all() {}
+
+void sync_icache(void const*, size_t) {}
+void invalidate_icache_all() {}
+
+}  // namespace lib::cache
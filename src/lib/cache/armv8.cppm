@@ -0,0 +1,174 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+module;
+
+#include <arch/aarch64/sysreg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+export module lib.cache.arch;
+
+namespace lib::cache {
+
+constexpr unsigned long CTR_IDC = 1UL << 28;  // no dcache clean needed for icache coherency
+constexpr unsigned long CTR_DIC = 1UL << 29;  // no icache invalidation needed
+
+// call @op with the address of every line of @line bytes touched by [@addr, @addr + @size)
+template <typename F>
+[[gnu::always_inline]] inline void for_each_line(void const* addr, size_t size, size_t line,
+                                                 F op) {
+    // an empty range touches no line, even when @addr is not line aligned
+    if (!size)
+        return;
+    auto start = reinterpret_cast<uintptr_t>(addr) & ~(line - 1);
+    auto end = reinterpret_cast<uintptr_t>(addr) + size;
+    for (auto p = start; p < end; p += line)
+        op(p);
+}
+
+enum class sw_op { CLEAN, CLEAN_INVALIDATE };
+
+//
+// Operation on every dcache line by set/way, up to the level of coherency
+//
+void set_way(sw_op op) {
+    unsigned long clidr = sysreg_read(clidr_el1);
+    unsigned loc = (clidr >> 24) & 0x7;
+    // FEAT_CCIDX, CCSIDR_EL1 has the 64 bits layout with wider associativity and sets fields
+    bool ccidx = (sysreg_read(id_aa64mmfr2_el1) >> 20) & 0xf;
+
+    for (unsigned level = 0; level != loc; ++level) {
+        // 2: dcache only, 3: separate I/D, 4: unified
+        if (((clidr >> (level * 3)) & 0x7) < 2)
+            continue;
+
+        sysreg_write(csselr_el1, level << 1);
+        asm volatile("isb");
+        unsigned long ccsidr = sysreg_read(ccsidr_el1);
+
+        unsigned line_shift = (ccsidr & 0x7) + 4;
+        unsigned ways, sets;
+        if (ccidx) {
+            ways = ((ccsidr >> 3) & 0x1f'ffff) + 1;
+            sets = ((ccsidr >> 32) & 0xff'ffff) + 1;
+        } else {
+            ways = ((ccsidr >> 3) & 0x3ff) + 1;
+            sets = ((ccsidr >> 13) & 0x7fff) + 1;
+        }
+        unsigned way_shift = ways > 1 ? __builtin_clz(ways - 1) : 0;
+
+        for (unsigned long way = 0; way != ways; ++way) {
+            for (unsigned long set = 0; set != sets; ++set) {
+                unsigned long v = way << way_shift | set << line_shift | level << 1;
+                if (op == sw_op::CLEAN)
+                    asm volatile("dc csw, %0" ::"r"(v) : "memory");
+                else
+                    asm volatile("dc cisw, %0" ::"r"(v) : "memory");
+            }
+        }
+    }
+
+    asm volatile("dsb sy");
+    asm volatile("isb");
+}
+
+}  // namespace lib::cache
+
+export namespace lib::cache {
+
+// smallest dcache line in the system, from CTR_EL0
+size_t dcache_line() {
+    return 4UL << ((sysreg_read(ctr_el0) >> 16) & 0xf);
+}
+
+// smallest icache line in the system, from CTR_EL0
+size_t icache_line() {
+    return 4UL << (sysreg_read(ctr_el0) & 0xf);
+}
+
+//
+// clean - Write back the dirty lines of the range to memory, up to the point of coherency
+//
+void clean(void const* addr, size_t size) {
+    for_each_line(addr, size, dcache_line(),
+                  [](uintptr_t p) { asm volatile("dc cvac, %0" ::"r"(p) : "memory"); });
+    asm volatile("dsb sy" ::: "memory");
+}
+
+//
+// clean_invalidate - Write back and drop the lines of the range
+//
+void clean_invalidate(void const* addr, size_t size) {
+    for_each_line(addr, size, dcache_line(),
+                  [](uintptr_t p) { asm volatile("dc civac, %0" ::"r"(p) : "memory"); });
+    asm volatile("dsb sy" ::: "memory");
+}
+
+//
+// invalidate - Drop the lines of the range without writing them back
+//
+// Lines only partially in the range are cleaned too, so data next to the range is not lost
+//
+void invalidate(void* addr, size_t size) {
+    size_t line = dcache_line();
+    auto start = reinterpret_cast<uintptr_t>(addr);
+    auto end = start + size;
+
+    for_each_line(addr, size, line, [&](uintptr_t p) {
+        if (p < start || p + line > end)
+            asm volatile("dc civac, %0" ::"r"(p) : "memory");
+        else
+            asm volatile("dc ivac, %0" ::"r"(p) : "memory");
+    });
+    asm volatile("dsb sy" ::: "memory");
+}
+
+//
+// clean_all/clean_invalidate_all - Whole dcache by set/way
+//
+// Only for the local cpu with the caches of the other cpus quiet, e.g. before turning the mmu or
+// the caches off. Use the range operations for anything else
+//
+void clean_all() {
+    set_way(sw_op::CLEAN);
+}
+
+void clean_invalidate_all() {
+    set_way(sw_op::CLEAN_INVALIDATE);
+}
+
+//
+// sync_icache - Make code written to [@addr, @addr + @size) visible to instruction fetches
+//
+// The maintenance is broadcast to the inner shareable domain, but the final isb only flushes the
+// pipeline of the calling cpu. Other cpus must run their own isb (an exception entry/return does it
+// too) before they execute the new code
+//
+void sync_icache(void const* addr, size_t size) {
+    unsigned long ctr = sysreg_read(ctr_el0);
+
+    if (!(ctr & CTR_IDC)) {
+        for_each_line(addr, size, dcache_line(),
+                      [](uintptr_t p) { asm volatile("dc cvau, %0" ::"r"(p) : "memory"); });
+    }
+    asm volatile("dsb ish" ::: "memory");
+
+    if (!(ctr & CTR_DIC)) {
+        for_each_line(addr, size, icache_line(),
+                      [](uintptr_t p) { asm volatile("ic ivau, %0" ::"r"(p) : "memory"); });
+        asm volatile("dsb ish" ::: "memory");
+    }
+    asm volatile("isb");
+}
+
+void invalidate_icache_all() {
+    asm volatile("ic ialluis");
+    asm volatile("dsb ish");
+    asm volatile("isb");
+}
+
+}  // namespace lib::cache
@@ -0,0 +1,21 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Cache maintenance
+ *
+ * Range operations take virtual addresses and work on every line the range touches, so buffers
+ * shared with devices (DMA) or other masters should be aligned to dcache_line() and a multiple of
+ * it. Typical use for DMA:
+ *  - before the device reads memory: clean()
+ *  - before the cpu reads what the device wrote: invalidate() (after the transfer, and before it if
+ *    the cpu may have dirty lines there)
+ *  - after writing code to memory: sync_icache()
+ */
+
+export module lib.cache;
+
+export import lib.cache.arch;
@@ -30,4 +30,10 @@ void restore_irq(unsigned long flags) {
     sysreg_write(primask, flags);
 }
 
+// true when this cpu can't take interrupts, interrupts have the same priority so that is also the
+// case inside any handler
+bool irq_masked() {
+    return (sysreg_read(primask) & 1) || sysreg_read(ipsr);
+}
+
 }  // namespace lib::cpu
@@ -35,6 +35,11 @@ void restore_irq(long flags) {
     asm volatile("msr daif, %0" ::"r"(flags));
 }
 
+// true when this cpu can't take interrupts (e.g. irqsafe locks, interrupt and exception handlers)
+bool irq_masked() {
+    return sysreg_read(daif) & (1 << 7);
+}
+
 unsigned id() {
     unsigned mpidr = sysreg_read(mpidr_el1);
     unsigned id = mpidr & 0xffffff;
@@ -4,6 +4,19 @@
  * Copyright (c) 2021 Fernando Lugo <lugo.fernando@gmail.com>
  */
 
+module;
+
+#ifndef CONFIG_MAX_CPUS
+#define CONFIG_MAX_CPUS 8
+#endif
+
 export module lib.cpu;
 export import lib.cpu.arch;
 export import lib.cpu.soc;
+
+export namespace lib::cpu {
+
+// upper bound of id(), per cpu data is sized with it
+constexpr unsigned MAX_CPUS = CONFIG_MAX_CPUS;
+
+}  // namespace lib::cpu
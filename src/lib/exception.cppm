@@ -14,6 +14,8 @@
 module;
 
 #include <errcodes.h>
+#include <stddef.h>
+#include <string.h>
 
 export module lib.exception;
 
@@ -23,13 +25,28 @@ export namespace lib {
 
 class exception {
  public:
-    exception(std::string const& s, int code = ERR_GENERIC) : str(s), code(code) {}
-    std::string const& msg() const { return str; }
+    exception(char const* s, int code = ERR_GENERIC) : code(code) { set_msg(s); }
+    exception(std::string const& s, int code = ERR_GENERIC) : code(code) { set_msg(s.c_str()); }
+    char const* msg() const { return long_str.empty() ? str : long_str.c_str(); }
     int error() { return code; }
 
  private:
-    std::string str;
+    // messages shorter than this are kept inline, so throwing does not need the heap
+    static constexpr size_t MSG_INLINE_MAX = 48;
+
+    char str[MSG_INLINE_MAX];
+    std::string long_str;
     int code;
+
+    void set_msg(char const* s) {
+        size_t len = strlen(s);
+        if (len < MSG_INLINE_MAX) {
+            memcpy(str, s, len + 1);
+        } else {
+            str[0] = '\0';
+            long_str = s;
+        }
+    }
 };
 
 }  // namespace lib
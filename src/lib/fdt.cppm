@@ -0,0 +1,379 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Flattened device tree (DTB) parser
+ *
+ * It works on the blob in place and never allocates, so it can be used from early init before the
+ * heap is ready. Nodes and properties are returned as small handles pointing into the blob, the
+ * blob must stay around while they are used. Every offset read from the blob is bounds checked, a
+ * malformed blob makes lookups fail instead of reading out of it.
+ */
+
+module;
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+export module lib.fdt;
+
+export namespace lib {
+
+class fdt {
+ public:
+    static constexpr unsigned MAX_DEPTH = 16;
+
+    struct node {
+        uint32_t offset;  // first token after the node name
+        char const* name;  // including the unit address, "" for the root node
+        unsigned depth;  // 0 for the root node
+        // #address-cells and #size-cells of the parent, they describe the "reg" of this node
+        unsigned addr_cells;
+        unsigned size_cells;
+    };
+
+    struct prop {
+        uint8_t const* data = nullptr;
+        size_t len = 0;
+
+        explicit operator bool() const { return data != nullptr; }
+
+        // number of 32 bits cells
+        size_t num_cells() const { return len / 4; }
+
+        // cell @idx, 0 if it is out of the property
+        uint32_t u32(size_t idx = 0) const { return idx < num_cells() ? be32(data + idx * 4) : 0; }
+
+        // value made of @n (1 or 2) cells starting at cell @idx
+        uint64_t cells(size_t idx, unsigned n) const {
+            return n == 2 ? uint64_t(u32(idx)) << 32 | u32(idx + 1) : u32(idx);
+        }
+
+        // string value, nullptr if it is not NUL terminated
+        char const* str() const {
+            return len && data[len - 1] == '\0' ? reinterpret_cast<char const*>(data) : nullptr;
+        }
+
+        // true if the string list value has @s
+        bool has_string(char const* s) const {
+            auto p = reinterpret_cast<char const*>(data);
+            auto end = p + len;
+            while (p < end) {
+                size_t n = strnlen(p, end - p);
+                if (p + n == end)
+                    break;
+                if (!strcmp(p, s))
+                    return true;
+                p += n + 1;
+            }
+            return false;
+        }
+    };
+
+    fdt() = default;
+    explicit fdt(void const* blob) { init(blob); }
+
+    //
+    // init - Use the blob at @blob, returns false (and the tree stays empty) if it is not valid
+    //
+    bool init(void const* blob);
+
+    bool valid() const { return structs != nullptr; }
+
+    // size of the whole blob, 0 if there is no valid one
+    size_t size() const { return total; }
+
+    //
+    // walk - Call @f(node const&) for every node in the tree, or only for the nodes under @parent,
+    // in depth first order. @f returns true to stop the walk, then walk returns true too.
+    //
+    template <typename F>
+    bool walk(F&& f, node const* parent = nullptr) const;
+
+    // call @f for every direct child of @parent, @f returns true to stop
+    template <typename F>
+    bool for_each_child(node const& parent, F&& f) const {
+        return walk([&](node const& n) { return n.depth == parent.depth + 1 && f(n); }, &parent);
+    }
+
+    //
+    // find - Look up the node at @path (e.g. "/cpus/cpu@1"), components without a unit address
+    // match any unit address
+    //
+    bool find(char const* path, node& n) const;
+
+    // first node compatible with @compat
+    bool find_compatible(char const* compat, node& n) const {
+        return walk([&](node const& c) {
+            if (!is_compatible(c, compat))
+                return false;
+            n = c;
+            return true;
+        });
+    }
+
+    prop get(node const& n, char const* name) const;
+
+    bool is_compatible(node const& n, char const* compat) const {
+        return get(n, "compatible").has_string(compat);
+    }
+
+    //
+    // reg - Address and size of entry @idx of the "reg" property of @n
+    //
+    bool reg(node const& n, size_t idx, uint64_t& addr, uint64_t& size) const;
+
+ private:
+    static constexpr uint32_t MAGIC = 0xd00d'feed;
+    static constexpr uint32_t BEGIN_NODE = 1;
+    static constexpr uint32_t END_NODE = 2;
+    static constexpr uint32_t PROP = 3;
+    static constexpr uint32_t NOP = 4;
+    static constexpr uint32_t END = 9;
+
+    // cells when the parent has no #address-cells/#size-cells
+    static constexpr unsigned DEFAULT_ADDR_CELLS = 2;
+    static constexpr unsigned DEFAULT_SIZE_CELLS = 1;
+
+    static uint32_t be32(void const* p) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        v = __builtin_bswap32(v);
+#endif
+        return v;
+    }
+
+    static constexpr uint32_t align4(uint32_t v) { return (v + 3) & ~3U; }
+
+    // token at @off, advancing @off over it. Returns false at the end of the struct block
+    bool token(uint32_t& off, uint32_t& tag) const {
+        if (off > struct_size - 4)
+            return false;
+        tag = be32(structs + off);
+        off += 4;
+        return true;
+    }
+
+    //
+    // Skip the node name at @off, returns nullptr if it goes out of the struct block
+    //
+    char const* node_name(uint32_t& off) const {
+        auto name = reinterpret_cast<char const*>(structs + off);
+        size_t len = strnlen(name, struct_size - off);
+        if (len == struct_size - off)
+            return nullptr;
+        off = align4(off + len + 1);
+        return name;
+    }
+
+    //
+    // Read the property header at @off and skip it, returns false if it is malformed
+    //
+    bool read_prop(uint32_t& off, char const*& name, prop& p) const {
+        if (struct_size - off < 8)
+            return false;
+        uint32_t len = be32(structs + off);
+        uint32_t name_off = be32(structs + off + 4);
+        if (len > struct_size - off - 8 || name_off >= strings_size)
+            return false;
+
+        name = strings + name_off;
+        p.data = structs + off + 8;
+        p.len = len;
+        off = align4(off + 8 + len);
+        return true;
+    }
+
+    uint8_t const* structs = nullptr;
+    uint32_t struct_size = 0;
+    char const* strings = nullptr;
+    uint32_t strings_size = 0;
+    uint32_t total = 0;
+};
+
+template <typename F>
+bool fdt::walk(F&& f, node const* parent) const {
+    struct {
+        unsigned addr;
+        unsigned size;
+    } cells[MAX_DEPTH + 2];
+
+    if (!valid())
+        return false;
+
+    // cells[d] holds the cells for the nodes at depth d, they are set by the parent
+    int top = parent ? int(parent->depth) : -1;
+    int depth = top;
+    uint32_t off = parent ? parent->offset : 0;
+    cells[depth + 1] = {DEFAULT_ADDR_CELLS, DEFAULT_SIZE_CELLS};
+
+    for (uint32_t tag; token(off, tag);) {
+        switch (tag) {
+        case BEGIN_NODE: {
+            if (depth + 1 > int(MAX_DEPTH))
+                return false;
+            auto name = node_name(off);
+            if (!name)
+                return false;
+
+            depth++;
+            cells[depth + 1] = {DEFAULT_ADDR_CELLS, DEFAULT_SIZE_CELLS};
+            node n{off, name, unsigned(depth), cells[depth].addr, cells[depth].size};
+            if (f(n))
+                return true;
+            break;
+        }
+        case END_NODE:
+            if (depth == top)
+                return false;
+            depth--;
+            break;
+        case PROP: {
+            char const* name;
+            prop p;
+            if (!read_prop(off, name, p))
+                return false;
+            if (!strcmp(name, "#address-cells"))
+                cells[depth + 1].addr = p.u32();
+            else if (!strcmp(name, "#size-cells"))
+                cells[depth + 1].size = p.u32();
+            break;
+        }
+        case NOP:
+            break;
+        default:
+            // END or garbage
+            return false;
+        }
+    }
+
+    return false;
+}
+
+bool fdt::init(void const* blob) {
+    structs = nullptr;
+    total = 0;
+
+    auto base = static_cast<uint8_t const*>(blob);
+    if (!base || reinterpret_cast<uintptr_t>(base) % 4)
+        return false;
+
+    // header fields, only the ones used here (version 17)
+    enum : uint32_t {
+        MAGIC_OFF = 0,
+        TOTALSIZE = 4,
+        OFF_DT_STRUCT = 8,
+        OFF_DT_STRINGS = 12,
+        VERSION = 20,
+        LAST_COMP_VERSION = 24,
+        SIZE_DT_STRINGS = 32,
+        SIZE_DT_STRUCT = 36,
+        HEADER_SIZE = 40,
+    };
+
+    if (be32(base + MAGIC_OFF) != MAGIC || be32(base + VERSION) < 17 ||
+        be32(base + LAST_COMP_VERSION) > 17)
+        return false;
+
+    uint32_t size = be32(base + TOTALSIZE);
+    uint32_t soff = be32(base + OFF_DT_STRUCT);
+    uint32_t ssize = be32(base + SIZE_DT_STRUCT);
+    uint32_t stroff = be32(base + OFF_DT_STRINGS);
+    uint32_t strsize = be32(base + SIZE_DT_STRINGS);
+
+    if (size < HEADER_SIZE || soff % 4 || ssize % 4 || ssize < 4)
+        return false;
+    if (soff > size || ssize > size - soff || stroff > size || strsize > size - stroff)
+        return false;
+    // so strcmp() on property names never runs out of the strings block
+    if (strsize && base[stroff + strsize - 1] != '\0')
+        return false;
+
+    structs = base + soff;
+    struct_size = ssize;
+    strings = reinterpret_cast<char const*>(base + stroff);
+    strings_size = strsize;
+    total = size;
+    return true;
+}
+
+bool fdt::find(char const* path, node& n) const {
+    if (*path != '/')
+        return false;
+
+    // @matched is the depth of the deepest node matched so far, @comp is the next component
+    int matched = -1;
+    char const* comp = path;
+    bool found = false;
+
+    walk([&](node const& c) {
+        if (int(c.depth) <= matched)
+            return true;  // out of the matched node, node names are unique so it is not there
+        if (int(c.depth) != matched + 1)
+            return false;
+
+        size_t len = strcspn(comp, "/");
+        if (c.depth == 0) {
+            len = 0;
+        } else {
+            size_t name_len = strlen(c.name);
+            // without unit address, compare only the node name
+            if (!memchr(comp, '@', len))
+                name_len = strcspn(c.name, "@");
+            if (len != name_len || strncmp(comp, c.name, len))
+                return false;
+        }
+
+        matched++;
+        comp += len;
+        while (*comp == '/')
+            comp++;
+        if (*comp == '\0') {
+            n = c;
+            found = true;
+            return true;
+        }
+        return false;
+    });
+
+    return found;
+}
+
+fdt::prop fdt::get(node const& n, char const* name) const {
+    uint32_t off = n.offset;
+    for (uint32_t tag; token(off, tag);) {
+        if (tag == NOP)
+            continue;
+        if (tag != PROP)
+            break;  // properties come before subnodes
+
+        char const* pname;
+        prop p;
+        if (!read_prop(off, pname, p))
+            break;
+        if (!strcmp(pname, name))
+            return p;
+    }
+    return {};
+}
+
+bool fdt::reg(node const& n, size_t idx, uint64_t& addr, uint64_t& size) const {
+    if (n.addr_cells < 1 || n.addr_cells > 2 || n.size_cells > 2)
+        return false;
+
+    auto p = get(n, "reg");
+    size_t entry = n.addr_cells + n.size_cells;
+    if ((idx + 1) * entry > p.num_cells())
+        return false;
+
+    addr = p.cells(idx * entry, n.addr_cells);
+    size = n.size_cells ? p.cells(idx * entry + n.addr_cells, n.size_cells) : 0;
+    return true;
+}
+
+}  // namespace lib
@@ -4,8 +4,25 @@
  * Copyright (C) 2020 Fernando Lugo <lugo.fernando@gmail.com>
  */
 
+/*
+ * Format printing with {} placeholders, e.g. println("{} = {:#010x}", name, val)
+ *
+ * Format strings are parsed at compile time: placeholders are checked against the number and type
+ * of the arguments (a mistake fails the build) and their modifiers are stored in a table together
+ * with the position of the literal text around them. At runtime printing only walks that table,
+ * literal text goes out with one write and nothing is allocated for the format parsing.
+ *
+ * Console output of a print() call is collected in the line buffer of the current thread and sent
+ * to the console with a single write when the call ends (or when the buffer gets full). Without
+ * thread support, or when the buffer is already in use (e.g. an interrupt handler printing in the
+ * middle of a thread print), output goes directly to the console.
+ *
+ * Modifiers: {[:][<|>][#][0][width][d|x|X|o|c|p]}, "{{" and "}}" print a single brace.
+ */
+
 module;
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -13,19 +30,47 @@ export module lib.fmt;
 
 export import std.string;
 export import std.concepts;
+import std.utility;
 import device.console;
 
 static device::console* con;
 
+// Boards that know their console at build time can define it to call the driver directly, so
+// prints avoid virtual calls. Without it (null) output goes to the registered console
+extern "C" [[gnu::weak]] void board_console_write(char const* s, size_t n);
+
 static inline void putchar(int c) {
-    if (con)
+    char ch = c;
+    if (board_console_write)
+        board_console_write(&ch, 1);
+    else if (con)
         con->putc(c);
 }
 
-static inline void puts(char const* str) {
-    if (con)
-        while (int c = *str++)
-            con->putc(c);
+static inline void write(char const* s, size_t n) {
+    if (board_console_write)
+        board_console_write(s, n);
+    else if (con)
+        con->write(s, n);
+}
+
+export namespace lib::fmt {
+
+// print() output buffer, each thread has one
+struct line_buffer {
+    static constexpr size_t SIZE = 128;
+
+    bool busy;
+    uint16_t len;
+    char buf[SIZE];
+};
+
+}  // namespace lib::fmt
+
+// The thread library provides the buffer of the current thread, this one is only used when there is
+// no thread support
+extern "C" [[gnu::weak]] void* fmt_get_line_buffer() {
+    return nullptr;
 }
 
 // module private data
@@ -40,106 +85,282 @@ enum fmt_flags {
 };
 
 struct modifiers {
-    unsigned flags;
-    unsigned width;
-    unsigned base;
+    uint8_t flags;
+    uint8_t base;
+    uint16_t width;
 };
 
-class fmt_out {
- public:
-    fmt_out(std::string* s = nullptr) : str_p(s) {}
-
-    fmt_out& operator<<(char c) {
-        if (str_p)
-            *str_p += c;
-        else
-            putchar(c);
-        return *this;
-    }
-    fmt_out& operator<<(const char* c_str) {
-        if (str_p)
-            *str_p += c_str;
-        else
-            puts(c_str);
-        return *this;
-    }
+// literal text between placeholders, @escaped is set when it has "{{" or "}}"
+struct literal {
+    uint16_t start;
+    uint16_t len;
+    bool escaped;
+};
 
- private:
-    std::string* str_p;
+// argument types, modifiers are checked against them at compile time
+enum class arg_kind : uint8_t {
+    INTEGER,
+    POINTER,
+    STRING,
+    OTHER,
 };
 
+// std::string or any other basic_string<char> allocator variant
+template <typename T>
+constexpr bool is_string = false;
+
+template <typename A>
+constexpr bool is_string<std::basic_string<char, A>> = true;
+
+template <typename T>
+consteval arg_kind kind_of() {
+    using U = std::decay_t<T>;
+    if constexpr (std::integral<U>)
+        return arg_kind::INTEGER;
+    else if constexpr (std::same_as<U, const char*> || std::same_as<U, char*> || is_string<U>)
+        return arg_kind::STRING;
+    else if constexpr (std::pointer<U>)
+        return arg_kind::POINTER;
+    else
+        return arg_kind::OTHER;
+}
+
+// not constexpr: reaching it while a format string is parsed fails the build, the compiler error
+// points here and shows @msg
+void format_error(char const* msg) {
+    (void)msg;
+}
+
 //
 // Parse format string modifiers. e.g {:<08x}
 //
-modifiers parse_modifiers(const std::string& flags) {
-    modifiers m{0, 0, 10};
-
-    if (flags.size() == 0)
-        return m;
-
-    unsigned& f = m.flags;
-    unsigned& w = m.width;
-    unsigned& b = m.base;
-
-    int index = 0;
-    char c = flags[index++];
-
-    if (c == ':')
-        c = flags[index++];
+// @s points after the '{', on return it points to the closing '}'
+//
+constexpr modifiers parse_modifiers(char const*& s, arg_kind kind) {
+    modifiers m{0, 10, 0};
+    unsigned width = 0;
 
-    if (!c)
-        return m;
+    if (*s == ':')
+        s++;
 
-    if (c == '<' || c == '>') {
-        f |= c == '<' ? FMT_LEFT : 0;
-        if (!(c = flags[index++]))
-            return m;
+    if (*s == '<' || *s == '>') {
+        if (*s == '<')
+            m.flags |= FMT_LEFT;
+        s++;
     }
 
-    if (c == '#') {
-        f |= FMT_POUND;
-        c = flags[index++];
+    if (*s == '#') {
+        m.flags |= FMT_POUND;
+        s++;
     }
 
-    if (c == '0') {
-        f |= FMT_ZEROPAD;
-        c = flags[index++];
+    if (*s == '0') {
+        m.flags |= FMT_ZEROPAD;
+        s++;
     }
 
-    while (c) {
-        if (c < '0' || c > '9')
-            break;
-        w = w * 10 + c - '0';
-        c = flags[index++];
+    for (; *s >= '0' && *s <= '9'; ++s) {
+        width = width * 10 + *s - '0';
+        if (width > UINT16_MAX)
+            format_error("fmt: width too big");
     }
+    m.width = width;
 
-    if (!c)
-        return m;
+    bool numeric = kind == arg_kind::INTEGER || kind == arg_kind::POINTER;
 
     // check for base modifier
-    switch (c) {
+    switch (*s) {
+    case '}':
+        return m;
     case 'd':
         break;
     case 'X':
-        f |= FMT_CAPS;
+        m.flags |= FMT_CAPS;
+        [[fallthrough]];
     case 'x':
-        b = 16;
+        m.base = 16;
         break;
     case 'o':
-        b = 8;
+        m.base = 8;
+        break;
+    case 'p':
+        m.base = 16;
+        m.flags |= FMT_POUND;
         break;
     case 'c':
         // force char conversion (only valid for integrals)
-        f |= FMT_CHAR;
+        if (kind != arg_kind::INTEGER)
+            format_error("fmt: {:c} needs an integer argument");
+        m.flags |= FMT_CHAR;
+        numeric = true;
+        break;
+    case 0:
+        format_error("fmt: missing '}' in format");
+        break;
+    default:
+        format_error("fmt: invalid format modifier");
         break;
     }
+
+    if (!numeric)
+        format_error("fmt: numeric modifier used with a non numeric argument");
+
+    if (*++s != '}')
+        format_error("fmt: invalid format modifier");
+
     return m;
 }
 
+//
+// Parsed format string with @N placeholders. Parsing happens at compile time (format_string),
+// packed arguments parse it again at runtime from a string that was already checked
+//
+template <size_t N>
+struct format_spec {
+    char const* str;
+    literal lits[N + 1];
+    // last one is unused, it avoids a zero sized array
+    modifiers mods[N + 1];
+
+    constexpr format_spec(char const* s, arg_kind const* kinds) : str(s), lits{}, mods{} {
+        size_t n = 0;
+        char const* p = s;
+        char const* start = s;
+        bool escaped = false;
+
+        while (*p) {
+            if ((p[0] == '{' && p[1] == '{') || (p[0] == '}' && p[1] == '}')) {
+                escaped = true;
+                p += 2;
+                continue;
+            }
+
+            if (*p == '}')
+                format_error("fmt: unmatched '}' in format");
+
+            if (*p == '{') {
+                if (n == N)
+                    format_error("fmt: more placeholders than arguments");
+
+                lits[n] = make_literal(start, p, escaped);
+                mods[n] = parse_modifiers(++p, kinds[n]);
+                n++;
+                start = ++p;
+                escaped = false;
+                continue;
+            }
+            p++;
+        }
+
+        if (n != N)
+            format_error("fmt: less placeholders than arguments");
+
+        lits[N] = make_literal(start, p, escaped);
+    }
+
+    constexpr literal make_literal(char const* start, char const* end, bool escaped) {
+        if (end - str > UINT16_MAX)
+            format_error("fmt: format string too long");
+
+        return literal{static_cast<uint16_t>(start - str), static_cast<uint16_t>(end - start),
+                       escaped};
+    }
+};
+
+//
+// Take the line buffer of the current thread, nullptr if there is none or it is already in use
+//
+line_buffer* line_get() {
+    auto lb = static_cast<line_buffer*>(fmt_get_line_buffer());
+    if (!lb || lb->busy)
+        return nullptr;
+
+    // only interrupt handlers on this cpu can race with us, a compiler barrier is enough
+    lb->busy = true;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    return lb;
+}
+
+void line_flush(line_buffer* lb) {
+    if (lb->len) {
+        write(lb->buf, lb->len);
+        lb->len = 0;
+    }
+}
+
+void line_write(line_buffer* lb, char const* s, size_t n) {
+    while (n) {
+        if (lb->len == line_buffer::SIZE)
+            line_flush(lb);
+
+        size_t room = line_buffer::SIZE - lb->len;
+        size_t chunk = n < room ? n : room;
+        memcpy(&lb->buf[lb->len], s, chunk);
+        lb->len += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+//
+// Flush and give back a buffer from line_get()
+//
+void line_put(line_buffer* lb) {
+    if (!lb)
+        return;
+
+    line_flush(lb);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    lb->busy = false;
+}
+
+// Output to console, to a line buffer or to a string, the string can use any allocator
+class fmt_out {
+ public:
+    fmt_out(line_buffer* lb = nullptr) : str_p(nullptr), append(nullptr), line(lb) {}
+
+    template <typename A>
+    fmt_out(std::basic_string<char, A>* s) : str_p(s), line(nullptr) {
+        append = [](void* p, char const* s, size_t n) {
+            auto& str = *static_cast<std::basic_string<char, A>*>(p);
+            for (size_t i = 0; i != n; ++i)
+                str += s[i];
+        };
+    }
+
+    void write(char const* s, size_t n) {
+        if (str_p)
+            append(str_p, s, n);
+        else if (line)
+            line_write(line, s, n);
+        else
+            ::write(s, n);
+    }
+
+    fmt_out& operator<<(char c) {
+        if (str_p)
+            append(str_p, &c, 1);
+        else if (line)
+            line_write(line, &c, 1);
+        else
+            putchar(c);
+        return *this;
+    }
+    fmt_out& operator<<(const char* c_str) {
+        write(c_str, strlen(c_str));
+        return *this;
+    }
+
+ private:
+    void* str_p;
+    void (*append)(void*, char const*, size_t);
+    line_buffer* line;
+};
+
 //
 // Print c-style string to fmt_out
 //
-void fmt_print_string(const char* s, int w, int f, fmt_out fout = {}) {
+void fmt_print_string(const char* s, int w, int f, fmt_out fout) {
     char pad = f & FMT_ZEROPAD ? '0' : ' ';
     bool hex_prefix = f & FMT_POUND;
 
@@ -168,8 +389,10 @@ void fmt_print_string(const char* s, int w, int f, fmt_out fout = {}) {
         fout << pad;
 }
 
-void fmt_print_integer(uint64_t n, bool neg, modifiers& mod, fmt_out fout = {}) {
-    auto& [f, w, b] = mod;
+void fmt_print_integer(uint64_t n, bool neg, modifiers mod, fmt_out fout) {
+    unsigned f = mod.flags;
+    unsigned b = mod.base;
+    int w = mod.width;
 
     // check if we are printing an char
     if (f & FMT_CHAR) {
@@ -219,124 +442,146 @@ void fmt_print_integer(uint64_t n, bool neg, modifiers& mod, fmt_out fout = {})
     fmt_print_string(s, w, f, fout);
 }
 
+//
+// Print the literal text @l of the format string @str, escaped braces are printed once
+//
+void fmt_print_literal(char const* str, literal l, fmt_out fout) {
+    char const* s = str + l.start;
+    char const* end = s + l.len;
+
+    if (!l.escaped) {
+        fout.write(s, l.len);
+        return;
+    }
+
+    // braces in literal text always come in pairs
+    for (char const* p = s; p != end; ++p) {
+        if (*p == '{' || *p == '}') {
+            fout.write(s, p - s + 1);
+            s = ++p + 1;
+        }
+    }
+    fout.write(s, end - s);
+}
+
+template <typename T>
+void fmt_print_arg(T const& val, modifiers mod, fmt_out fout) {
+    // remove cv and reference for doing type comparations, arrays are printed as pointers
+    using U = std::decay_t<T>;
+
+    if constexpr (std::integral<U>) {
+        bool neg = mod.base == 10 && std::signed_integral<U> && val < 0;
+        uint64_t num = neg ? -static_cast<int64_t>(val) : val;
+        fmt_print_integer(num, neg, mod, fout);
+    } else if constexpr (std::same_as<U, const char*> || std::same_as<U, char*>) {
+        char const* s = val;
+        fmt_print_string(s ?: "(nullptr)", mod.width, mod.flags, fout);
+    } else if constexpr (std::pointer<U>) {
+        auto p = reinterpret_cast<uintptr_t>(val);
+        mod.base = 16;
+        mod.flags |= FMT_POUND;
+        fmt_print_integer(p, false, mod, fout);
+    } else if constexpr (is_string<U>) {
+        fmt_print_string(val.c_str(), mod.width, mod.flags, fout);
+    } else {
+        static_assert(std::is_convertible_v<U, std::string>, "fmt: unsupported type");
+        fmt_print_string(std::string(val).c_str(), mod.width, mod.flags, fout);
+    }
+}
+
+template <typename U>
+U unpack(uint64_t word) {
+    if constexpr (std::integral<U>)
+        return static_cast<U>(word);
+    else
+        return reinterpret_cast<U>(static_cast<uintptr_t>(word));
+}
+
+template <size_t N, typename... Args>
+void fmt_print(fmt_out fout, format_spec<N> const& fmt, Args const&... args) {
+    size_t i = 0;
+    ((fmt_print_literal(fmt.str, fmt.lits[i], fout), fmt_print_arg(args, fmt.mods[i], fout), ++i),
+     ...);
+    fmt_print_literal(fmt.str, fmt.lits[N], fout);
+}
+
 }  // namespace lib::fmt
 
 // public (exported) part
 export namespace lib::fmt {
 
 //
-// Ends print template recursion. This handles the case when only fmt is specified
+// Format string for @Args, it can only be created from a string known at compile time
 //
-void print(const char* fmt) {
-    puts(fmt);
-}
+template <typename... Args>
+struct format_string : format_spec<sizeof...(Args)> {
+    static constexpr arg_kind kinds[] = {kind_of<Args>()..., arg_kind::OTHER};
+
+    consteval format_string(char const* s) : format_spec<sizeof...(Args)>(s, kinds) {}
+};
 
 //
 // Format printing to default console output
 //
-template <typename T, typename... Args>
-void print(const char* fmt, T&& val, Args&&... args) {
-    // remove cv and reference for doing type comparations
-    using U = std::remove_cv_t<std::remove_reference_t<T>>;
-    while (*fmt) {
-        if (*fmt == '{' && *++fmt != '{') {
-            std::string flags;
-            for (; *fmt && *fmt != '}'; ++fmt)
-                flags += *fmt;
-            if (!*fmt++)
-                return;  // "missing '}' in format"
-
-            auto mod = parse_modifiers(flags);
-
-            if constexpr (std::integral<U>) {
-                bool neg = mod.base == 10 && std::signed_integral<U> && val < 0;
-                auto num = neg ? -static_cast<int64_t>(val) : val;
-                fmt_print_integer(num, neg, mod);
-            } else if constexpr (std::same_as<U, const char*> || std::same_as<U, char*>) {
-                fmt_print_string(val ?: "(nullptr)", mod.width, mod.flags);
-            } else if constexpr (std::pointer<U>) {
-                auto p = reinterpret_cast<uintptr_t>(val);
-                mod.base = 16;
-                mod.flags |= FMT_POUND;
-                fmt_print_integer(p, false, mod);
-            } else if constexpr (std::same_as<U, std::string>) {
-                fmt_print_string(val.c_str(), mod.width, mod.flags);
-            } else {
-                static_assert(std::is_convertible_v<U, std::string>, "fmt: unsupported type");
-                fmt_print_string(std::string(val).c_str(), mod.width, mod.flags);
-            }
-            print(fmt, std::forward<Args>(args)...);
-            return;
-        }
-        if (*fmt == '}' && *++fmt != '}')
-            return;  // "unmatched '}' in format"
-                     // hh::cout << *fmt++;
-        putchar(*fmt++);
-    }
+template <typename... Args>
+void print(format_string<std::type_identity_t<Args>...> fmt, Args&&... args) {
+    auto lb = line_get();
+    fmt_print(lb, fmt, args...);
+    line_put(lb);
 }
 
-//
-// Ends sprint template recursion. This handles the case when only fmt is specified
-//
-void sprint(std::string& str, const char* fmt) {
-    str += fmt;
+template <typename... Args>
+void println(format_string<std::type_identity_t<Args>...> fmt, Args&&... args) {
+    auto lb = line_get();
+    fmt_out fout(lb);
+    fmt_print(fout, fmt, args...);
+    fout << '\n';
+    line_put(lb);
 }
 
 //
-// Format printing to std::string
+// Format printing to std::string, @str can use any allocator (e.g. lib::arena_string)
 //
-template <typename T, typename... Args>
-void sprint(std::string& str, const char* fmt, T&& val, Args&&... args) {
-    // remove cv and reference for doing type comparations
-    using U = std::remove_cv_t<std::remove_reference_t<T>>;
-    while (*fmt) {
-        if (*fmt == '{' && *++fmt != '{') {
-            std::string flags;
-            for (; *fmt && *fmt != '}'; ++fmt)
-                flags += *fmt;
-            if (!*fmt++)
-                return;  // missing '}' in format
-
-            auto mod = parse_modifiers(flags);
-
-            if constexpr (std::integral<U>) {
-                bool neg = mod.base == 10 && std::signed_integral<T> && val < 0;
-                if (neg)
-                    val = -static_cast<int64_t>(val);
-
-                fmt_print_integer(val, neg, mod, &str);
-            } else if constexpr (std::same_as<U, const char*> || std::same_as<U, char*>) {
-                fmt_print_string(val ?: "(nullptr)", mod.width, mod.flags, &str);
-            } else if constexpr (std::pointer<U>) {
-                auto p = reinterpret_cast<uintptr_t>(val);
-                mod.base = 16;
-                mod.flags |= FMT_POUND;
-                fmt_print_integer(p, false, mod, &str);
-            } else if constexpr (std::same_as<U, std::string>) {
-                fmt_print_string(val.c_str(), mod.width, mod.flags, &str);
-            } else {
-                static_assert(std::is_convertible_v<U, std::string>, "fmt: unsupported type");
-                fmt_print_string(std::string(val).c_str(), mod.width, mod.flags, &str);
-            }
-            return sprint(str, fmt, std::forward<Args>(args)...);
-        }
-        if (*fmt == '}' && *++fmt != '}')
-            return;  // unmatched '}' in format
-        str += *fmt++;
-    }
+template <typename A, typename... Args>
+void sprint(std::basic_string<char, A>& str, format_string<std::type_identity_t<Args>...> fmt,
+            Args&&... args) {
+    fmt_print(&str, fmt, args...);
 }
 
 template <typename... Args>
-std::string sprint(const char* fmt, Args&&... args) {
+std::string sprint(format_string<std::type_identity_t<Args>...> fmt, Args&&... args) {
     std::string str;
-    sprint(str, fmt, std::forward<Args>(args)...);
+    fmt_print(&str, fmt, args...);
     return str;
 }
 
-template <typename... Args>
-void println(const char* fmt, Args&&... args) {
-    print(fmt, std::forward<Args>(args)...);
-    putchar('\n');
+//
+// Packed arguments: raw words that can be printed later, when the format string and the arguments
+// are gone (e.g. log records). Only integers and pointers can be packed, strings are packed as
+// pointers so they must outlive the words (e.g. literals)
+//
+template <typename T>
+concept packable = std::integral<std::decay_t<T>> || std::pointer<std::decay_t<T>>;
+
+template <packable T>
+uint64_t pack(T const& val) {
+    if constexpr (std::integral<T>)
+        return static_cast<uint64_t>(val);
+    else
+        return reinterpret_cast<uintptr_t>(val);
+}
+
+// print @str with the arguments packed in @words, @Args must be the types of the original call
+template <packable... Args>
+void print_packed(char const* str, uint64_t const* words) {
+    using fmt_type = format_string<Args...>;
+
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        format_spec<sizeof...(Args)> spec(str, fmt_type::kinds);
+        auto lb = line_get();
+        fmt_print(lb, spec, unpack<std::decay_t<Args>>(words[I])...);
+        line_put(lb);
+    }(std::index_sequence_for<Args...>{});
 }
 
 void register_console(device::console* console) {
@@ -14,33 +14,21 @@ export module lib.gpio;
 
 export import device.gpio;
 import board.peripherals;
+import lib.cpu;
+import lib.exception;
 import lib.fmt;
+import lib.inplace_function;
 import std.string;
 
+using lib::exception;
 using lib::fmt::println;
 using std::string;
 
-template <typename T>
-std::decay_t<T> decay_copy(T&& v) {
-    return std::forward<T>(v);
-}
-
-class gpio_cb {
- public:
-    virtual void operator()() = 0;
-    virtual ~gpio_cb() {}
-};
-
-template <typename F>
-class gpio_cb_wrapper : public gpio_cb {
- public:
-    gpio_cb_wrapper(F&& f) : func{decay_copy(std::forward<F>(f))} {}
+// gpio numbers that can have an irq callback
+constexpr unsigned MAX_IRQ_GPIOS = 32;
 
-    void operator()() override { return func(); }
-
- private:
-    std::decay_t<F> func;
-};
+// callbacks are stored here, installing a new one replaces the previous one without allocating
+static lib::inplace_function<void()> irq_callbacks[MAX_IRQ_GPIOS];
 
 export namespace lib::gpio {
 
@@ -69,16 +57,21 @@ bool get(unsigned gpio) {
 
 template <typename F>
 void register_irq(unsigned gpio, F&& f) {
+    if (gpio >= MAX_IRQ_GPIOS)
+        throw exception("invalid gpio number", ERR_INVALID_ARGS);
+
     auto& dev = board::peripherals::default_gpio();
+    auto& cb = irq_callbacks[gpio];
+
+    // the irq must not run the callback while it is half replaced
+    auto flags = lib::cpu::save_and_disable_irq();
+    cb = std::forward<F>(f);
+    lib::cpu::restore_irq(flags);
 
-    gpio_cb* cb = new gpio_cb_wrapper(std::forward<F>(f));
     return dev.register_irq(
         gpio,
-        [](void* data) {
-            auto callback = reinterpret_cast<gpio_cb*>(data);
-            (*callback)();
-        },
-        cb);
+        [](void* data) { (*reinterpret_cast<lib::inplace_function<void()>*>(data))(); },
+        &cb);
 }
 
 }  // namespace lib::gpio
@@ -10,18 +10,18 @@
 import lib.heap;
 
 extern "C" void* malloc(size_t size) {
-    return lib::heap::alloc(size);
+    return lib::heap::alloc(size, 8, __builtin_return_address(0));
 }
 
 extern "C" void* calloc(size_t nmemb, size_t size) {
-    void* ptr = malloc(nmemb * size);
+    void* ptr = lib::heap::alloc(nmemb * size, 8, __builtin_return_address(0));
     if (ptr)
         memset(ptr, 0, nmemb * size);
     return ptr;
 }
 
 extern "C" void* realloc(void* ptr, size_t size) {
-    return lib::heap::realloc(ptr, size);
+    return lib::heap::realloc(ptr, size, 8, __builtin_return_address(0));
 }
 
 extern "C" void free(void* p) {
@@ -0,0 +1,319 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Heap allocation tracker. It records the call site (return address of the function that called
+ * the allocator) of every live allocation and keeps per call site counters, so that memory leaks
+ * can be found by comparing the live allocations by site at two different points in time.
+ *
+ * It cannot use dynamic memory, all tables are statically allocated and their sizes can be
+ * changed with CONFIG_HEAP_TRACKER_ENTRIES and CONFIG_HEAP_TRACKER_SITES (both power of 2). If the
+ * live table is full new allocations are not tracked, they are just counted as dropped.
+ */
+
+module;
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+export module lib.heap.tracker;
+
+import lib.lock;
+
+using lib::lock;
+using lib::slock_irqsafe;
+
+#ifndef CONFIG_HEAP_TRACKER_ENTRIES
+#define CONFIG_HEAP_TRACKER_ENTRIES 4096
+#endif
+
+#ifndef CONFIG_HEAP_TRACKER_SITES
+#define CONFIG_HEAP_TRACKER_SITES 512
+#endif
+
+constexpr size_t ENTRIES = CONFIG_HEAP_TRACKER_ENTRIES;
+constexpr size_t SITES = CONFIG_HEAP_TRACKER_SITES;
+
+static_assert(!(ENTRIES & (ENTRIES - 1)), "heap tracker entries needs to be power of 2");
+static_assert(!(SITES & (SITES - 1)), "heap tracker sites needs to be power of 2");
+
+// extra site slot used when site table is full
+constexpr uint32_t SITE_OTHER = SITES;
+
+export namespace lib::heap::tracker {
+
+struct site_info {
+    uintptr_t site;      // call site address, 0 means sites that did not fit in the table
+    size_t live_count;   // allocations not freed yet
+    size_t live_bytes;   // bytes not freed yet
+    size_t total_count;  // allocations done since tracking was enabled
+};
+
+struct leak_info {
+    uintptr_t site;
+    long count;  // change of live allocations since the mark
+    long bytes;  // change of live bytes since the mark
+};
+
+// live allocation taken out of the tracker by take(), it can be put back with restore()
+struct saved_alloc {
+    uintptr_t ptr;  // 0 if it was not tracked
+    uint32_t size;
+    uint32_t site;  // index in the site table
+};
+
+struct info {
+    bool enabled;
+    size_t tracked;  // live allocations currently tracked
+    size_t dropped;  // allocations not tracked because the table was full
+    size_t sites;    // call sites in use
+};
+
+}  // namespace lib::heap::tracker
+
+namespace {
+
+struct entry {
+    uintptr_t ptr;
+    uint32_t size;
+    uint32_t site;
+};
+
+struct site_entry {
+    uintptr_t site;
+    size_t live_count;
+    size_t live_bytes;
+    size_t total_count;
+};
+
+struct snapshot_entry {
+    size_t live_count;
+    size_t live_bytes;
+};
+
+lock tracker_lock;
+bool enabled = true;
+size_t tracked;
+size_t dropped;
+size_t sites_used;
+bool marked;
+
+entry live[ENTRIES];
+site_entry sites[SITES + 1];
+snapshot_entry snap[SITES + 1];
+
+uintptr_t key(void const* p) {
+    auto v = reinterpret_cast<uintptr_t>(p);
+#if __UINTPTR_WIDTH__ == 64
+    // ignore top byte, MTE stores the tag there
+    v &= 0x00ff'ffff'ffff'ffffUL;
+#endif
+    return v;
+}
+
+size_t hash(uintptr_t v) {
+    // allocations are at least 8 bytes aligned
+    v >>= 3;
+#if __UINTPTR_WIDTH__ == 64
+    return (v * 0x9e37'79b9'7f4a'7c15UL) >> 32;
+#else
+    return (v * 0x9e37'79b9U) >> 16;
+#endif
+}
+
+uint32_t site_index(uintptr_t site) {
+    size_t i = hash(site) & (SITES - 1);
+    for (size_t n = 0; n < SITES; ++n, i = (i + 1) & (SITES - 1)) {
+        if (sites[i].site == site)
+            return i;
+        if (!sites[i].site) {
+            sites[i].site = site;
+            sites_used++;
+            return i;
+        }
+    }
+    return SITE_OTHER;
+}
+
+entry* find(uintptr_t ptr) {
+    size_t i = hash(ptr) & (ENTRIES - 1);
+    for (size_t n = 0; n < ENTRIES; ++n, i = (i + 1) & (ENTRIES - 1)) {
+        if (live[i].ptr == ptr)
+            return &live[i];
+        if (!live[i].ptr)
+            return nullptr;
+    }
+    return nullptr;
+}
+
+// linear probing removal without tombstones, move back entries that belong to the cluster
+void remove(entry* e) {
+    auto& s = sites[e->site];
+    s.live_count--;
+    s.live_bytes -= e->size;
+    tracked--;
+
+    size_t i = e - live;
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & (ENTRIES - 1);
+        if (!live[j].ptr)
+            break;
+        size_t k = hash(live[j].ptr) & (ENTRIES - 1);
+        // keep entry where it is if its home slot is cyclically in (i, j]
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        live[i] = live[j];
+        i = j;
+    }
+    live[i].ptr = 0;
+}
+
+void insert_at(uintptr_t ptr, size_t size, uint32_t idx) {
+    // same address tracked twice means the free was missed while tracker was disabled
+    if (auto e = find(ptr))
+        remove(e);
+
+    if (tracked >= ENTRIES - 1) {
+        dropped++;
+        return;
+    }
+
+    size_t i = hash(ptr) & (ENTRIES - 1);
+    while (live[i].ptr)
+        i = (i + 1) & (ENTRIES - 1);
+
+    live[i] = {ptr, static_cast<uint32_t>(size), idx};
+    tracked++;
+
+    auto& s = sites[idx];
+    s.live_count++;
+    s.live_bytes += size;
+}
+
+void insert(uintptr_t ptr, size_t size, uintptr_t site) {
+    auto idx = site_index(site);
+    insert_at(ptr, size, idx);
+    sites[idx].total_count++;
+}
+
+void reset() {
+    memset(live, 0, sizeof live);
+    memset(sites, 0, sizeof sites);
+    memset(snap, 0, sizeof snap);
+    tracked = 0;
+    dropped = 0;
+    sites_used = 0;
+    marked = false;
+}
+
+}  // namespace
+
+export namespace lib::heap::tracker {
+
+void record_alloc(void const* p, size_t size, void const* site) {
+    if (!enabled || !p)
+        return;
+
+    slock_irqsafe guard{tracker_lock};
+    insert(key(p), size, key(site));
+}
+
+void record_free(void const* p) {
+    if (!enabled || !p)
+        return;
+
+    slock_irqsafe guard{tracker_lock};
+    if (auto e = find(key(p)))
+        remove(e);
+}
+
+//
+// take - Stop tracking @p and return its entry, for a block that is about to be freed but can
+// survive (e.g. realloc). It has to be done before the block is freed, once freed another cpu
+// can get the same address and record it
+//
+saved_alloc take(void const* p) {
+    if (!enabled || !p)
+        return {};
+
+    slock_irqsafe guard{tracker_lock};
+    auto e = find(key(p));
+    if (!e)
+        return {};
+    saved_alloc a{e->ptr, e->size, e->site};
+    remove(e);
+    return a;
+}
+
+// track again an allocation from take() that was not freed after all
+void restore(saved_alloc const& a) {
+    if (!enabled || !a.ptr)
+        return;
+
+    slock_irqsafe guard{tracker_lock};
+    insert_at(a.ptr, a.size, a.site);
+}
+
+// enabling the tracker again starts from a clean state
+void enable(bool en) {
+    slock_irqsafe guard{tracker_lock};
+    if (en && !enabled)
+        reset();
+    enabled = en;
+}
+
+info get_info() {
+    slock_irqsafe guard{tracker_lock};
+    return {enabled, tracked, dropped, sites_used};
+}
+
+// copy all sites with live allocations to @out, returns number of sites copied
+size_t get_sites(site_info* out, size_t max) {
+    slock_irqsafe guard{tracker_lock};
+    size_t n = 0;
+    for (size_t i = 0; i <= SITES && n < max; ++i) {
+        auto& s = sites[i];
+        if (!s.live_count)
+            continue;
+        out[n++] = {s.site, s.live_count, s.live_bytes, s.total_count};
+    }
+    return n;
+}
+
+// take a snapshot of the live allocations by site, it is used as reference by get_leaks()
+void mark() {
+    slock_irqsafe guard{tracker_lock};
+    for (size_t i = 0; i <= SITES; ++i)
+        snap[i] = {sites[i].live_count, sites[i].live_bytes};
+    marked = true;
+}
+
+// copy sites whose live allocations grew since the last mark() to @out, returns number of sites
+// copied or -1 if there is no mark
+long get_leaks(leak_info* out, size_t max) {
+    slock_irqsafe guard{tracker_lock};
+    if (!marked)
+        return -1;
+
+    size_t n = 0;
+    for (size_t i = 0; i <= SITES && n < max; ++i) {
+        auto& s = sites[i];
+        long count = s.live_count - snap[i].live_count;
+        long bytes = s.live_bytes - snap[i].live_bytes;
+        if (count <= 0 && bytes <= 0)
+            continue;
+        out[n++] = {s.site, count, bytes};
+    }
+    return n;
+}
+
+constexpr size_t max_sites() {
+    return SITES + 1;
+}
+
+}  // namespace lib::heap::tracker
@@ -15,25 +15,231 @@ extern "C" uint8_t __heap_end[];
 export module lib.heap;
 
 import lib.allocator.simple;
+export import lib.allocator.stats;
+import lib.cpu;
 
-static lib::allocator::simple heap(__heap_start, __heap_end);
+#ifdef CONFIG_HEAP_TRACKER
+export import lib.heap.tracker;
+#endif
+
+// placement new prototype
+void* operator new(size_t size, void* ptr);
+
+#ifndef CONFIG_HEAP_MAX_REGIONS
+#define CONFIG_HEAP_MAX_REGIONS 4
+#endif
+
+export namespace lib::heap {
+
+// allocation hints, when no region matches the hint the allocation comes from the main heap
+enum class hint {
+    DEFAULT,     // general purpose memory (main heap)
+    CORE_LOCAL,  // memory with the least bus contention for a given cpu, e.g. stacks
+    DMA,         // memory suitable for DMA buffers
+};
+
+// region flags
+enum region_flags : unsigned {
+    REGION_DEFAULT = 1 << 0,     // serves default allocations
+    REGION_CORE_LOCAL = 1 << 1,  // local to the region cpu
+    REGION_DMA = 1 << 2,         // can be used for DMA
+};
+
+constexpr unsigned CPU_CURRENT = ~0U;
+
+struct region_info {
+    char const* name;
+    uintptr_t start;
+    uintptr_t end;
+    unsigned flags;
+    unsigned cpu;
+};
+
+}  // namespace lib::heap
+
+namespace {
+
+using lib::allocator::simple;
+using namespace lib::heap;
+
+constexpr size_t MAX_REGIONS = CONFIG_HEAP_MAX_REGIONS;
+
+struct region {
+    region_info info;
+    simple* heap;
+};
+
+simple main_heap(__heap_start, __heap_end);
+
+// storage for the allocators of the regions added at runtime
+alignas(simple) uint8_t region_heaps[MAX_REGIONS][sizeof(simple)];
+
+// regions are only added during init, region 0 is the main heap
+region regions[MAX_REGIONS] = {
+    {{"main", 0, 0, REGION_DEFAULT | REGION_DMA, 0}, &main_heap},
+};
+size_t region_count = 1;
+
+uintptr_t untag(void const* p) {
+    auto v = reinterpret_cast<uintptr_t>(p);
+#if __UINTPTR_WIDTH__ == 64
+    // ignore top byte, MTE stores the tag there
+    v &= 0x00ff'ffff'ffff'ffffUL;
+#endif
+    return v;
+}
+
+region* region_of(void const* p) {
+    auto addr = untag(p);
+    for (size_t i = 1; i < region_count; ++i)
+        if (addr >= regions[i].info.start && addr < regions[i].info.end)
+            return &regions[i];
+    return &regions[0];
+}
+
+void* region_alloc(size_t size, size_t align, hint h, unsigned cpu) {
+    if (h != hint::DEFAULT) {
+        unsigned flag = h == hint::CORE_LOCAL ? REGION_CORE_LOCAL : REGION_DMA;
+        if (cpu == CPU_CURRENT)
+            cpu = lib::cpu::id();
+
+        for (size_t i = 1; i < region_count; ++i) {
+            auto& r = regions[i];
+            if (!(r.info.flags & flag))
+                continue;
+            if (h == hint::CORE_LOCAL && r.info.cpu != cpu)
+                continue;
+            if (void* p = r.heap->alloc(size, align))
+                return p;
+        }
+    }
+
+    if (void* p = main_heap.alloc(size, align))
+        return p;
+
+    // main heap is full, use the other regions that serve default allocations
+    for (size_t i = 1; i < region_count; ++i) {
+        if (!(regions[i].info.flags & REGION_DEFAULT))
+            continue;
+        if (void* p = regions[i].heap->alloc(size, align))
+            return p;
+    }
+    return nullptr;
+}
+
+}  // namespace
 
 export namespace lib::heap {
 
 void init() {
-    ::heap.init();
+    main_heap.init();
+    regions[0].info.start = reinterpret_cast<uintptr_t>(__heap_start);
+    regions[0].info.end = reinterpret_cast<uintptr_t>(__heap_end);
 }
 
-void* alloc(size_t size, size_t align = 8) {
-    return ::heap.alloc(size, align);
+//
+// add_region - Add a memory region to the heap
+//
+// It is not thread safe, it must be called during init before the region is used by anybody
+//
+// @name    Region name, only for debugging
+// @start   Start address of the region
+// @end     End address of the region (exclusive)
+// @flags   region_flags, which allocation hints this region can serve
+// @cpu     Cpu the region is local to (only for REGION_CORE_LOCAL)
+//
+bool add_region(char const* name, void* start, void* end, unsigned flags, unsigned cpu = 0) {
+    if (region_count == MAX_REGIONS)
+        return false;
+
+    size_t i = region_count;
+    auto h = new (region_heaps[i])
+        simple(static_cast<uint8_t*>(start), static_cast<uint8_t*>(end));
+    h->init();
+    regions[i] = {{name, untag(start), untag(end), flags, cpu}, h};
+    region_count++;
+    return true;
 }
 
-void* realloc(void* p, size_t size, size_t align = 8) {
-    return ::heap.realloc(p, size, align);
+// @site is the allocation call site used by the heap tracker, when it is not passed the return
+// address of the caller is used, that's why alloc/realloc are never inlined
+[[gnu::noinline]] void* alloc(size_t size, size_t align = 8, void const* site = nullptr) {
+    void* p = region_alloc(size, align, hint::DEFAULT, 0);
+#ifdef CONFIG_HEAP_TRACKER
+    tracker::record_alloc(p, size, site ?: __builtin_return_address(0));
+#else
+    (void)site;
+#endif
+    return p;
+}
+
+//
+// alloc - Allocate memory from the region that better matches @h
+//
+// @cpu     Cpu for hint::CORE_LOCAL, the current one by default
+//
+[[gnu::noinline]] void* alloc(size_t size, size_t align, hint h, unsigned cpu = CPU_CURRENT,
+                              void const* site = nullptr) {
+    void* p = region_alloc(size, align, h, cpu);
+#ifdef CONFIG_HEAP_TRACKER
+    tracker::record_alloc(p, size, site ?: __builtin_return_address(0));
+#else
+    (void)site;
+#endif
+    return p;
+}
+
+// memory is reallocated in the same region @p belongs to
+[[gnu::noinline]] void* realloc(void* p, size_t size, size_t align = 8,
+                                void const* site = nullptr) {
+#ifdef CONFIG_HEAP_TRACKER
+    // like free(), @p is forgotten before the heap can hand it out again
+    auto old = tracker::take(p);
+    void* np = region_of(p)->heap->realloc(p, size, align);
+    if (np)
+        tracker::record_alloc(np, size, site ?: __builtin_return_address(0));
+    else
+        tracker::restore(old);
+#else
+    (void)site;
+    void* np = region_of(p)->heap->realloc(p, size, align);
+#endif
+    return np;
 }
 
 void free(void* p) {
-    return ::heap.free(p);
+#ifdef CONFIG_HEAP_TRACKER
+    tracker::record_free(p);
+#endif
+    if (p)
+        region_of(p)->heap->free(p);
+}
+
+using stats_t = lib::allocator::stats;
+
+// snapshot of the heap counters plus free block information, @region 0 is the main heap
+stats_t stats(size_t idx = 0) {
+    return idx < region_count ? regions[idx].heap->get_stats() : stats_t{};
+}
+
+// set peak usage to the current usage, useful for measuring a specific workload
+void reset_peak() {
+    for (size_t i = 0; i < region_count; ++i)
+        regions[i].heap->reset_peak();
+}
+
+// print every heap chunk, this is slow and only meant for debugging
+void dump(size_t idx = 0) {
+    if (idx < region_count)
+        regions[idx].heap->dump();
+}
+
+size_t num_regions() {
+    return region_count;
+}
+
+region_info get_region(size_t idx) {
+    return idx < region_count ? regions[idx].info : region_info{};
 }
 
 }  // namespace lib::heap
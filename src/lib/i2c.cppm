@@ -15,12 +15,15 @@ export module lib.i2c;
 
 import device.i2c;
 import lib.fmt;
+import std.small_vector;
 import std.string;
-import std.vector;
 
 using lib::fmt::println;
+using std::small_vector;
 using std::string;
-using std::vector;
+
+// shell command buffers, longer transfers spill to the heap
+constexpr size_t CMD_BUF_INLINE = 32;
 
 void cmd_i2c_usage() {
     println("i2c list");
@@ -36,14 +39,6 @@ static void list_i2c_buses() {
         println("{}", dev->name());
 }
 
-static device::i2c* get_device(string const& name) {
-    auto devices = device::manager::find_all<device::i2c>();
-
-    for (auto dev : devices)
-        if (name == dev->name())
-            return dev;
-    return nullptr;
-}
 
 static int cmd_i2c(int argc, char const* argv[]) {
     if (argc < 2) {
@@ -63,7 +58,7 @@ static int cmd_i2c(int argc, char const* argv[]) {
         return 0;
     }
 
-    auto i2c = get_device(argv[2]);
+    auto i2c = device::manager::find<device::i2c>(argv[2]);
     if (i2c == nullptr) {
         println("could not find device {}", argv[2]);
         return 0;
@@ -73,13 +68,13 @@ static int cmd_i2c(int argc, char const* argv[]) {
 
     if (cmd == "read") {
         size_t size = argc == 5 ? strtoul(argv[4], NULL, 0) : 1;
-        vector<uint8_t> buf;
+        small_vector<uint8_t, CMD_BUF_INLINE> buf;
         buf.resize(size);
         i2c->read(addr, buf.data(), buf.size());
         for (auto v : buf)
             println("{:#x}", v);
     } else if (argc >= 5 && cmd == "write") {
-        vector<uint8_t> buf;
+        small_vector<uint8_t, CMD_BUF_INLINE> buf;
         for (int i = 4; i < argc; ++i) {
             uint8_t val = strtoul(argv[i], NULL, 0);
             buf.push_back(val);
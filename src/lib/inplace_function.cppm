@@ -0,0 +1,131 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * inplace_function<R(Args...), N>: type erased callable stored in @N bytes inside the object. There
+ * is no heap fallback, a callable that doesn't fit (or needs a bigger alignment) fails the build.
+ * It can be moved but not copied, so move-only callables work too. Calling an empty one throws.
+ */
+
+module;
+
+#include <errcodes.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <new>
+
+export module lib.inplace_function;
+
+export import std.type_traits;
+import lib.exception;
+
+// placement new prototype
+void* operator new(size_t size, void* ptr);
+
+export namespace lib {
+
+template <typename Sig, size_t N = 4 * sizeof(void*)>
+class inplace_function;
+
+template <typename R, typename... Args, size_t N>
+class inplace_function<R(Args...), N> {
+ public:
+    inplace_function() : ops(nullptr) {}
+    inplace_function(decltype(nullptr)) : ops(nullptr) {}
+
+    template <typename F>
+        requires(!std::is_same_v<std::decay_t<F>, inplace_function>)
+    inplace_function(F&& f) {
+        using T = std::decay_t<F>;
+        static_assert(sizeof(T) <= N, "inplace_function: callable too big, increase N");
+        static_assert(alignof(T) <= alignof(storage), "inplace_function: callable over aligned");
+
+        new (buf) T(std::forward<F>(f));
+        ops = &ops_for<T>;
+    }
+
+    inplace_function(inplace_function&& f) : ops(f.ops) {
+        if (ops) {
+            ops->move(buf, f.buf);
+            f.ops = nullptr;
+        }
+    }
+
+    inplace_function& operator=(inplace_function&& f) {
+        if (this != &f) {
+            reset();
+            ops = f.ops;
+            if (ops) {
+                ops->move(buf, f.buf);
+                f.ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    inplace_function& operator=(decltype(nullptr)) {
+        reset();
+        return *this;
+    }
+
+    template <typename F>
+        requires(!std::is_same_v<std::decay_t<F>, inplace_function>)
+    inplace_function& operator=(F&& f) {
+        return *this = inplace_function(std::forward<F>(f));
+    }
+
+    inplace_function(inplace_function const&) = delete;
+    inplace_function& operator=(inplace_function const&) = delete;
+
+    ~inplace_function() { reset(); }
+
+    R operator()(Args... args) {
+        if (!ops)
+            throw lib::exception("inplace_function: call to an empty function", ERR_INVALID_ARGS);
+        return ops->invoke(buf, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const { return ops != nullptr; }
+
+ private:
+    struct vtable {
+        R (*invoke)(void* p, Args&&... args);
+        // move constructs @dst from @src and destroys @src
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void* p);
+    };
+
+    template <typename T>
+    static constexpr vtable ops_for = {
+        [](void* p, Args&&... args) -> R {
+            return (*static_cast<T*>(p))(std::forward<Args>(args)...);
+        },
+        [](void* dst, void* src) {
+            new (dst) T(static_cast<T&&>(*static_cast<T*>(src)));
+            static_cast<T*>(src)->~T();
+        },
+        [](void* p) { static_cast<T*>(p)->~T(); },
+    };
+
+    union storage {
+        void* p;
+        uint64_t u;
+        long double d;
+    };
+
+    void reset() {
+        if (ops) {
+            ops->destroy(buf);
+            ops = nullptr;
+        }
+    }
+
+    vtable const* ops;
+    alignas(storage) uint8_t buf[N];
+};
+
+}  // namespace lib
@@ -14,6 +14,8 @@ class lock {
 
     [[gnu::always_inline]] void acquire();
     [[gnu::always_inline]] void release();
+    // acquire the lock only if it is free, true on success
+    [[gnu::always_inline]] bool try_acquire();
 
  public:
     unsigned val __attribute__((aligned(8)));
@@ -47,4 +49,17 @@ void lock::release() {
     asm volatile("stlr wzr, [%0]" ::"r"(&val));
 }
 
+bool lock::try_acquire() {
+    unsigned x, fail;
+    unsigned one = 1;
+
+    asm volatile("ldaxr    %w0, [%1]" : "=r"(x) : "r"(&val));
+    if (x) {
+        asm volatile("clrex");
+        return false;
+    }
+    asm volatile("stxr     %w0, %w1, [%2]" : "=r"(fail) : "r"(one), "r"(&val));
+    return !fail;
+}
+
 }  // namespace lib
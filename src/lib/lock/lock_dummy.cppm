@@ -14,6 +14,8 @@ class lock {
 
     [[gnu::always_inline]] void acquire();
     [[gnu::always_inline]] void release();
+    // acquire the lock only if it is free, true on success
+    [[gnu::always_inline]] bool try_acquire();
 
  public:
     unsigned val;
@@ -33,4 +35,11 @@ void lock::release() {
     val = 0;
 }
 
+bool lock::try_acquire() {
+    if (val)
+        return false;
+    val = 1;
+    return true;
+}
+
 }  // namespace lib
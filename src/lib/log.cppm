@@ -0,0 +1,176 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Deferred logging for hot paths (interrupt handlers, timer callbacks, the scheduler)
+ *
+ * log() does not format anything, it stores a binary record (timestamp, cpu, format string pointer
+ * and the arguments packed as raw words) in a ring owned by the current cpu. Writers only mask
+ * interrupts of their own cpu while they fill a record, so they never spin on other cpus. When a
+ * ring is full the oldest record is overwritten, a ring keeps the last RING_SIZE - 1 records.
+ *
+ * Records are formatted later by dump() (e.g. dmesg command), records from all cpus are merged by
+ * timestamp. Readers never block writers: a record is copied and then checked against the ring
+ * head, if the writer got to it meanwhile the copy is dropped. Arguments are limited to what
+ * lib::fmt can pack: integers and pointers, strings must outlive the record (e.g. literals).
+ */
+
+module;
+
+#include <stddef.h>
+#include <stdint.h>
+
+export module lib.log;
+
+import lib.fmt;
+import lib.cpu;
+import lib.timestamp;
+
+#ifndef CONFIG_LOG_RING_SIZE
+#define CONFIG_LOG_RING_SIZE 32
+#endif
+
+export namespace lib::log {
+
+constexpr size_t MAX_ARGS = 6;
+constexpr size_t RING_SIZE = CONFIG_LOG_RING_SIZE;
+
+static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "log ring size must be a power of 2");
+
+struct record {
+    uint64_t ticks;
+    char const* fmt;
+    void (*print)(char const* fmt, uint64_t const* words);
+    uint64_t args[MAX_ARGS];  // packed with lib::fmt::pack()
+};
+
+}  // namespace lib::log
+
+namespace lib::log {
+
+using cpu::MAX_CPUS;
+
+// @head is a free running index, only the owner cpu writes it. @start is where dump() begins
+// (moved by clear)
+struct ring {
+    size_t head;
+    size_t start;
+    record records[RING_SIZE];
+};
+
+ring rings[MAX_CPUS];
+
+//
+// Copy record @idx of @r to @rec, returns false if it was overwritten (or it is being written)
+//
+bool read_record(ring& r, size_t idx, record& rec) {
+    rec = r.records[idx % RING_SIZE];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&r.head, __ATOMIC_RELAXED) - idx < RING_SIZE;
+}
+
+// first record of @r that is still in the ring. The slot of @head - RING_SIZE is the one the next
+// log() writes, so at most RING_SIZE - 1 records can be read
+size_t first_record(ring& r) {
+    size_t head = __atomic_load_n(&r.head, __ATOMIC_ACQUIRE);
+    size_t oldest = head >= RING_SIZE ? head - RING_SIZE + 1 : 0;
+    return r.start > oldest ? r.start : oldest;
+}
+
+}  // namespace lib::log
+
+export namespace lib::log {
+
+//
+// log - Store a record for @fmt and @args, it will be formatted by dump()
+//
+template <fmt::packable... Args>
+void log(fmt::format_string<std::type_identity_t<Args>...> fmt, Args&&... args) {
+    static_assert(sizeof...(Args) <= MAX_ARGS, "log: too many arguments");
+
+    auto flags = cpu::save_and_disable_irq();
+    auto& r = rings[cpu::id()];
+    auto& rec = r.records[r.head % RING_SIZE];
+
+    rec.ticks = timestamp::ticks();
+    rec.fmt = fmt.str;
+    rec.print = fmt::print_packed<Args...>;
+    size_t i = 0;
+    ((rec.args[i++] = fmt::pack(args)), ...);
+
+    // the record is complete before readers can see it
+    __atomic_store_n(&r.head, r.head + 1, __ATOMIC_RELEASE);
+    cpu::restore_irq(flags);
+}
+
+//
+// for_each_record - Call @f(cpu, record const&) for the records of all cpus in timestamp order,
+// @clear drops them once visited. Returns the number of records that were overwritten before they
+// could be read
+//
+template <typename F>
+size_t for_each_record(F&& f, bool clear = false) {
+    size_t idx[MAX_CPUS];
+    size_t lost = 0;
+
+    for (unsigned c = 0; c != MAX_CPUS; ++c)
+        idx[c] = first_record(rings[c]);
+
+    for (;;) {
+        record rec, next;
+        unsigned cpu = MAX_CPUS;
+
+        // oldest record among the cpus
+        for (unsigned c = 0; c != MAX_CPUS; ++c) {
+            auto& r = rings[c];
+            while (idx[c] != __atomic_load_n(&r.head, __ATOMIC_ACQUIRE)) {
+                if (read_record(r, idx[c], next))
+                    break;
+                // overwritten while we were printing, skip to the oldest one
+                size_t first = first_record(r);
+                lost += first - idx[c];
+                idx[c] = first;
+            }
+            if (idx[c] == __atomic_load_n(&r.head, __ATOMIC_ACQUIRE))
+                continue;
+            if (cpu == MAX_CPUS || next.ticks < rec.ticks) {
+                rec = next;
+                cpu = c;
+            }
+        }
+        if (cpu == MAX_CPUS)
+            break;
+
+        idx[cpu]++;
+        f(cpu, static_cast<record const&>(rec));
+    }
+
+    if (clear) {
+        for (unsigned c = 0; c != MAX_CPUS; ++c)
+            rings[c].start = idx[c];
+    }
+
+    return lost;
+}
+
+//
+// dump - Print the records of all cpus in timestamp order, @clear drops them once printed
+//
+void dump(bool clear = false) {
+    size_t lost = for_each_record(
+        [](unsigned cpu, record const& rec) {
+            auto us = timestamp::ticks_to_us(rec.ticks);
+            fmt::print("[{:>5}.{:06}] {}: ", us / 1000'000, us % 1000'000, cpu);
+            rec.print(rec.fmt, rec.args);
+            fmt::println("");
+        },
+        clear);
+
+    if (lost)
+        fmt::println("log: {} records overwritten while printing", lost);
+}
+
+}  // namespace lib::log
@@ -0,0 +1,106 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Fixed size object pool. Storage for @N objects of type @T is part of the pool itself, so objects
+ * are created and destroyed in constant time without touching the global heap. Free slots are kept
+ * in a singly linked list which lives inside the unused slots.
+ *
+ * It is safe to use from multiple threads and from interrupt context.
+ */
+
+module;
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <new>
+
+export module lib.pool;
+
+import std.type_traits;
+import lib.lock;
+
+// placement new prototype
+void* operator new(size_t size, void* ptr);
+
+export namespace lib {
+
+template <typename T, size_t N>
+class pool {
+ public:
+    pool() {
+        for (size_t i = 0; i != N - 1; ++i)
+            slots[i].next = &slots[i + 1];
+        slots[N - 1].next = nullptr;
+        free_list = slots;
+        free_slots = N;
+    }
+
+    pool(pool const&) = delete;
+    pool& operator=(pool const&) = delete;
+
+    //
+    // create - Construct a new T object in a free slot
+    //
+    // Returns nullptr if all slots are in use
+    //
+    template <typename... Args>
+    T* create(Args&&... args) {
+        void* p = alloc();
+        if (!p)
+            return nullptr;
+        return new (p) T{std::forward<Args>(args)...};
+    }
+
+    //
+    // destroy - Destroy an object created with create() and give its slot back
+    //
+    void destroy(T* p) {
+        if (!p)
+            return;
+        p->~T();
+        free(p);
+    }
+
+    // raw slot allocation, no constructor/destructor is called
+    void* alloc() {
+        slock_irqsafe guard{l};
+        slot* s = free_list;
+        if (s) {
+            free_list = s->next;
+            free_slots--;
+        }
+        return s;
+    }
+
+    void free(void* p) {
+        auto s = static_cast<slot*>(p);
+        slock_irqsafe guard{l};
+        s->next = free_list;
+        free_list = s;
+        free_slots++;
+    }
+
+    bool owns(void const* p) const { return p >= &slots[0] && p < &slots[N]; }
+    size_t available() const { return free_slots; }
+    static constexpr size_t capacity() { return N; }
+
+ private:
+    static_assert(N > 0, "pool needs at least one slot");
+
+    union slot {
+        slot* next;
+        alignas(T) uint8_t data[sizeof(T)];
+    };
+
+    slot slots[N];
+    slot* free_list;
+    size_t free_slots;
+    lock l;
+};
+
+}  // namespace lib
@@ -15,15 +15,15 @@ export module lib.spi;
 
 import device.spi;
 import lib.fmt;
+import std.small_vector;
 import std.string;
-import std.vector;
 import lib.gpio;
 import lib.exception;
 
 using lib::exception;
 using lib::fmt::println;
+using std::small_vector;
 using std::string;
-using std::vector;
 
 export namespace lib::spi {
 
@@ -76,6 +76,9 @@ void dev::set_cs(bool cs) {
 
 }  // namespace lib::spi
 
+// shell command buffers, longer transfers spill to the heap
+constexpr size_t CMD_BUF_INLINE = 32;
+
 static void cmd_spi_usage() {
     println("spi list");
     println("spi read <name> [size]");
@@ -89,15 +92,6 @@ static void list_spi_buses() {
         println("{}", dev->name());
 }
 
-static device::spi* get_device(string const& name) {
-    auto devices = device::manager::find_all<device::spi>();
-
-    for (auto dev : devices)
-        if (name == dev->name())
-            return dev;
-    return nullptr;
-}
-
 static int cmd_spi(int argc, char const* argv[]) {
     if (argc < 2) {
         cmd_spi_usage();
@@ -116,7 +110,7 @@ static int cmd_spi(int argc, char const* argv[]) {
         return 0;
     }
 
-    auto spi = get_device(argv[2]);
+    auto spi = device::manager::find<device::spi>(argv[2]);
     if (spi == nullptr) {
         println("could not find device {}", argv[2]);
         return 0;
@@ -124,13 +118,13 @@ static int cmd_spi(int argc, char const* argv[]) {
 
     if (cmd == "read") {
         size_t size = argc == 4 ? strtoul(argv[3], NULL, 0) : 1;
-        vector<uint8_t> buf;
+        small_vector<uint8_t, CMD_BUF_INLINE> buf;
         buf.resize(size);
         spi->transfer(nullptr, buf.data(), buf.size());
         for (auto v : buf)
             println("{:#x}", v);
     } else if (argc >= 4 && cmd == "write") {
-        vector<uint8_t> buf;
+        small_vector<uint8_t, CMD_BUF_INLINE> buf;
         for (int i = 3; i < argc; ++i) {
             uint8_t val = strtoul(argv[i], NULL, 0);
             buf.push_back(val);
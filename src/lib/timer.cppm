@@ -14,6 +14,7 @@ export import lib.time;
 
 export import device.timer;
 export import std.type_traits;
+export import lib.inplace_function;
 import lib.fmt;
 import lib.exception;
 import lib.lock;
@@ -26,47 +27,24 @@ using lib::time::time_us_t;
 
 namespace {
 
-static device::timer* timer_dev;
+static device::handle<device::timer> timer_dev;
 static lock timer_lock;
 
 device::timer& get_timer() {
     slock_irqsafe guard{timer_lock};
-    if (timer_dev) {
-        return *timer_dev;
-    }
-
-    timer_dev = device::manager::find<::device::timer>();
-    if (!timer_dev) {
+    auto dev = timer_dev.get();
+    if (!dev) {
         throw exception("no timer", ERR_NOT_FOUND);
     }
-    return *timer_dev;
+    return *dev;
 }
 
 }  // namespace
 
 export namespace lib {
 
-template <typename T>
-std::decay_t<T> decay_copy(T&& v) {
-    return std::forward<T>(v);
-}
-
-class timer_cb {
- public:
-    virtual void operator()() = 0;
-    virtual ~timer_cb() {}
-};
-
-template <typename F>
-class timer_cb_wrapper : public timer_cb {
- public:
-    timer_cb_wrapper(F&& f) : func{decay_copy(std::forward<F>(f))} {}
-
-    void operator()() override { return func(); }
-
- private:
-    std::decay_t<F> func;
-};
+// timer callback, it is stored inside the timer object
+using timer_cb = inplace_function<void()>;
 
 class timer {
  public:
@@ -75,7 +53,7 @@ class timer {
         PERIODIC,
     };
 
-    timer(type type = type::PERIODIC) : cb(nullptr), e(nullptr), type(type) {}
+    timer(type type = type::PERIODIC) : e(nullptr), type(type) {}
     template <typename F>
     void start(F&& f, time_us_t period);
     void start(time_us_t period);
@@ -83,7 +61,9 @@ class timer {
     ~timer();
 
  private:
-    timer_cb* cb;
+    void arm(time_us_t period);
+
+    timer_cb cb;
     device::timer::event* e;
     type type;
 };
@@ -92,10 +72,17 @@ class timer {
 
 export namespace lib {
 
+//
+// start - Set callback @f and arm the timer
+//
+// @f replaces the previous callback in place, the timer must not be armed (stop() it first) and
+// it can't be called from the callback itself (use start(period) there)
+//
 template <typename F>
 void timer::start(F&& f, time_us_t period) {
     auto& dev = get_timer();
-    cb = new timer_cb_wrapper(std::forward<F>(f));
+    cb = std::forward<F>(f);
+
     auto dev_type =
         type == type::ONE_SHOT ? device::timer::type::ONE_SHOT : device::timer::type::PERIODIC;
     if (!e) {
@@ -104,18 +91,25 @@ void timer::start(F&& f, time_us_t period) {
             dev_type,
             [](void* data) {
                 auto self = reinterpret_cast<timer*>(data);
-                (*(self->cb))();
+                self->cb();
             },
             this);
     }
-    dev.set(e, period);
+    arm(period);
 }
 
 void timer::start(time_us_t period) {
-    if (cb == nullptr)
+    if (!cb)
         throw exception("no callback set");
-    auto& dev = get_timer();
-    dev.set(e, period);
+    arm(period);
+}
+
+// the board timer is called directly when it is known at build time
+void timer::arm(time_us_t period) {
+    if (board_timer_set)
+        board_timer_set(e, period);
+    else
+        get_timer().set(e, period);
 }
 
 void timer::stop() {
@@ -0,0 +1,203 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * NEON string scanning functions for aarch64
+ *
+ * Strings are scanned 16 bytes at a time using aligned loads only, an aligned load never crosses a
+ * page or an MTE granule, so reading past the end of a string is always safe. Bytes before the
+ * start of the string in the first block are masked out.
+ *
+ * Each compared byte is turned into a 4 bits mask with shrn, so the position of the first match
+ * is ctz(mask) / 4. Inside loops umaxp is used first, it is cheaper to just know if there is any
+ * match at all.
+ */
+
+#include <arm_neon.h>
+#include <stdint.h>
+#include <string.h>
+
+#define BLOCK 16
+
+static inline const uint8_t* block_of(const void* p) {
+    return (const uint8_t*)((uintptr_t)p & ~(uintptr_t)(BLOCK - 1));
+}
+
+// bits 4 * i to 4 * i + 3 are set when byte i of @cmp is 0xff
+static inline uint64_t nibble_mask(uint8x16_t cmp) {
+    uint8x8_t n = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(n), 0);
+}
+
+// true if any byte of @cmp is set
+static inline int any(uint8x16_t cmp) {
+    uint8x16_t m = vpmaxq_u8(cmp, cmp);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(m), 0) != 0;
+}
+
+// mask without the bytes before @p in its block
+static inline uint64_t skip_head(uint64_t mask, const void* p) {
+    return mask & (~0ULL << (((uintptr_t)p & (BLOCK - 1)) * 4));
+}
+
+static inline size_t first_of(uint64_t mask) {
+    return __builtin_ctzll(mask) / 4;
+}
+
+static inline size_t last_of(uint64_t mask) {
+    return (63 - __builtin_clzll(mask)) / 4;
+}
+
+size_t strlen(const char* s) {
+    const uint8_t* p = block_of(s);
+    uint8x16_t zero = vdupq_n_u8(0);
+
+    uint64_t m = skip_head(nibble_mask(vceqq_u8(vld1q_u8(p), zero)), s);
+    while (!m) {
+        p += BLOCK;
+        uint8x16_t z = vceqq_u8(vld1q_u8(p), zero);
+        if (any(z))
+            m = nibble_mask(z);
+    }
+
+    return p + first_of(m) - (const uint8_t*)s;
+}
+
+size_t strnlen(const char* s, size_t maxlen) {
+    if (!maxlen)
+        return 0;
+
+    const uint8_t* p = block_of(s);
+    // bytes of the string up to the end of the block at @p, s + maxlen can wrap so it is not used
+    size_t scanned = p + BLOCK - (const uint8_t*)s;
+    uint8x16_t zero = vdupq_n_u8(0);
+
+    uint64_t m = skip_head(nibble_mask(vceqq_u8(vld1q_u8(p), zero)), s);
+    while (!m) {
+        // no block is read past @maxlen, its block is the last one with bytes of the string
+        if (scanned >= maxlen)
+            return maxlen;
+        p += BLOCK;
+        scanned += BLOCK;
+        uint8x16_t z = vceqq_u8(vld1q_u8(p), zero);
+        if (any(z))
+            m = nibble_mask(z);
+    }
+
+    size_t len = p + first_of(m) - (const uint8_t*)s;
+    return len < maxlen ? len : maxlen;
+}
+
+void* memchr(const void* src, int c, size_t n) {
+    if (!n)
+        return NULL;
+
+    const uint8_t* p = block_of(src);
+    size_t scanned = p + BLOCK - (const uint8_t*)src;
+    uint8x16_t rep = vdupq_n_u8(c);
+
+    uint64_t m = skip_head(nibble_mask(vceqq_u8(vld1q_u8(p), rep)), src);
+    while (!m) {
+        if (scanned >= n)
+            return NULL;
+        p += BLOCK;
+        scanned += BLOCK;
+        uint8x16_t eq = vceqq_u8(vld1q_u8(p), rep);
+        if (any(eq))
+            m = nibble_mask(eq);
+    }
+
+    p += first_of(m);
+    return (size_t)(p - (const uint8_t*)src) < n ? (void*)p : NULL;
+}
+
+char* strchr(const char* s, int c) {
+    const uint8_t* p = block_of(s);
+    uint8x16_t rep = vdupq_n_u8(c);
+    uint8x16_t zero = vdupq_n_u8(0);
+
+    // stop at the first byte that is either @c or the terminator
+    uint8x16_t v = vld1q_u8(p);
+    uint64_t m = skip_head(nibble_mask(vorrq_u8(vceqq_u8(v, rep), vceqq_u8(v, zero))), s);
+    while (!m) {
+        p += BLOCK;
+        v = vld1q_u8(p);
+        uint8x16_t hit = vorrq_u8(vceqq_u8(v, rep), vceqq_u8(v, zero));
+        if (any(hit))
+            m = nibble_mask(hit);
+    }
+
+    p += first_of(m);
+    return *p == (uint8_t)c ? (char*)p : NULL;
+}
+
+char* strrchr(const char* s, int c) {
+    const uint8_t* p = block_of(s);
+    uint8x16_t rep = vdupq_n_u8(c);
+    uint8x16_t zero = vdupq_n_u8(0);
+
+    // last block with a match before the terminator block
+    const uint8_t* last = NULL;
+    uint64_t last_m = 0;
+
+    uint8x16_t v = vld1q_u8(p);
+    uint64_t eq = skip_head(nibble_mask(vceqq_u8(v, rep)), s);
+    uint64_t z = skip_head(nibble_mask(vceqq_u8(v, zero)), s);
+    while (!z) {
+        if (eq) {
+            last = p;
+            last_m = eq;
+        }
+        p += BLOCK;
+        v = vld1q_u8(p);
+        eq = nibble_mask(vceqq_u8(v, rep));
+        z = nibble_mask(vceqq_u8(v, zero));
+    }
+
+    // keep matches up to and including the terminator, so strrchr(s, 0) finds it
+    uint64_t low = z & -z;
+    eq &= (low - 1) | (low * 0xf);
+    if (eq)
+        return (char*)p + last_of(eq);
+
+    return last ? (char*)last + last_of(last_m) : NULL;
+}
+
+int strcmp(const char* s1, const char* s2) {
+    const uint8_t* a = (const uint8_t*)s1;
+    const uint8_t* b = (const uint8_t*)s2;
+
+    // blocks are compared only when both strings can be aligned at the same time, otherwise one
+    // of the loads could read past the end of its string into the next granule
+    if (((uintptr_t)a & (BLOCK - 1)) == ((uintptr_t)b & (BLOCK - 1))) {
+        uint8x16_t zero = vdupq_n_u8(0);
+
+        const uint8_t* pa = block_of(a);
+        const uint8_t* pb = block_of(b);
+        uint8x16_t va = vld1q_u8(pa);
+        uint8x16_t vb = vld1q_u8(pb);
+
+        // stop at the first different byte or at the terminator
+        uint8x16_t stop = vorrq_u8(vmvnq_u8(vceqq_u8(va, vb)), vceqq_u8(va, zero));
+        uint64_t m = skip_head(nibble_mask(stop), a);
+        while (!m) {
+            pa += BLOCK;
+            pb += BLOCK;
+            va = vld1q_u8(pa);
+            vb = vld1q_u8(pb);
+            stop = vorrq_u8(vmvnq_u8(vceqq_u8(va, vb)), vceqq_u8(va, zero));
+            if (any(stop))
+                m = nibble_mask(stop);
+        }
+
+        size_t i = first_of(m);
+        return pa[i] - pb[i];
+    }
+
+    for (; *a && *a == *b; ++a, ++b) {}
+
+    return *a - *b;
+}
@@ -15,6 +15,30 @@
 #define ALIGNP(_p, _a)      ((void*)ALIGN((unsigned long)(_p), _a))
 #define ALIGNP_DOWN(_p, _a) ((void*)ALIGN_DOWN((unsigned long)(_p), _a))
 
+/*
+ * Word at a time helpers. Words are only read from aligned addresses, so a read never crosses a
+ * page (or MTE granule) boundary and it is safe to read bytes past the end of a string.
+ */
+typedef unsigned long __attribute__((may_alias)) word_t;
+
+#define WORD_SIZE sizeof(word_t)
+#define ONES      ((word_t)-1 / 0xff)  // 0x01 in every byte
+#define HIGHS     (ONES * 0x80)        // 0x80 in every byte
+
+// non zero when any byte of @x is zero
+#define HAS_ZERO(x) (((x) - ONES) & ~(x) & HIGHS)
+
+// non zero when any byte of @x is equal to the byte replicated in @rep
+#define HAS_BYTE(x, rep) HAS_ZERO((x) ^ (rep))
+
+#define IS_ALIGNED(p) (((uintptr_t)(p) & (WORD_SIZE - 1)) == 0)
+
+/*
+ * The word at a time functions are always built with a generic_ prefix, so they can be tested on
+ * architectures with their own versions (HAVE_ARCH_*). Otherwise they are aliased to the standard
+ * names.
+ */
+
 char* strcpy(char* dest, const char* src) {
     char* d = dest;
 
@@ -31,12 +55,31 @@ char* strncpy(char* dest, const char* src, size_t n) {
     return d;
 }
 
-int strcmp(const char* s1, const char* s2) {
+int generic_strcmp(const char* s1, const char* s2) {
+    // word compare only when both strings can be aligned at the same time
+    if (((uintptr_t)s1 & (WORD_SIZE - 1)) == ((uintptr_t)s2 & (WORD_SIZE - 1))) {
+        for (; !IS_ALIGNED(s1); ++s1, ++s2)
+            if (!*s1 || *s1 != *s2)
+                goto last;
+
+        const word_t* w1 = (const word_t*)s1;
+        const word_t* w2 = (const word_t*)s2;
+        for (; *w1 == *w2 && !HAS_ZERO(*w1); ++w1, ++w2) {}
+
+        s1 = (const char*)w1;
+        s2 = (const char*)w2;
+    }
+
+last:
     for (; *s1 && *s1 == *s2; ++s1, ++s2) {}
 
-    return *s1 - *s2;
+    return (unsigned char)*s1 - (unsigned char)*s2;
 }
 
+#ifndef HAVE_ARCH_STRCMP
+int strcmp(const char* s1, const char* s2) __attribute__((alias("generic_strcmp")));
+#endif
+
 int strncmp(const char* s1, const char* s2, size_t n) {
     if (!n)
         return 0;
@@ -46,40 +89,96 @@ int strncmp(const char* s1, const char* s2, size_t n) {
     return *s1 - *s2;
 }
 
-size_t strlen(const char* s) {
+size_t generic_strlen(const char* s) {
     const char* t = s;
 
-    while (*t)
-        t++;
+    for (; !IS_ALIGNED(t); ++t)
+        if (!*t)
+            return t - s;
+
+    const word_t* w = (const word_t*)t;
+    while (!HAS_ZERO(*w))
+        w++;
+
+    for (t = (const char*)w; *t; ++t) {}
+
     return t - s;
 }
 
-size_t strnlen(const char* s, size_t maxlen) {
+#ifndef HAVE_ARCH_STRLEN
+size_t strlen(const char* s) __attribute__((alias("generic_strlen")));
+#endif
+
+size_t generic_strnlen(const char* s, size_t maxlen) {
     const char* t = s;
+    // bytes left, s + maxlen can wrap (e.g. maxlen is SIZE_MAX) so no end pointer is used
+    size_t n = maxlen;
+
+    for (; n && !IS_ALIGNED(t); ++t, --n)
+        if (!*t)
+            return t - s;
+
+    // only whole words within @maxlen
+    const word_t* w = (const word_t*)t;
+    for (; n >= WORD_SIZE && !HAS_ZERO(*w); ++w, n -= WORD_SIZE) {}
+
+    for (t = (const char*)w; n && *t; ++t, --n) {}
 
-    while (maxlen-- && *t)
-        t++;
     return t - s;
 }
 
-char* strchr(const char* s, int c) {
-    for (; *s; ++s)
-        if (*s == c)
+#ifndef HAVE_ARCH_STRNLEN
+size_t strnlen(const char* s, size_t maxlen) __attribute__((alias("generic_strnlen")));
+#endif
+
+char* generic_strchr(const char* s, int c) {
+    char ch = c;
+
+    for (; !IS_ALIGNED(s); ++s) {
+        if (*s == ch)
             return (char*)s;
+        if (!*s)
+            return NULL;
+    }
 
-    return NULL;
+    word_t rep = ONES * (unsigned char)ch;
+    const word_t* w = (const word_t*)s;
+    while (!HAS_ZERO(*w) && !HAS_BYTE(*w, rep))
+        w++;
+
+    // the terminator is part of the string, so strchr(s, 0) returns a pointer to it
+    for (s = (const char*)w;; ++s) {
+        if (*s == ch)
+            return (char*)s;
+        if (!*s)
+            return NULL;
+    }
 }
 
-char* strrchr(const char* s, int c) {
+#ifndef HAVE_ARCH_STRCHR
+char* strchr(const char* s, int c) __attribute__((alias("generic_strchr")));
+#endif
+
+char* generic_strrchr(const char* s, int c) {
     char* p = NULL;
 
-    for (; *s; ++s)
-        if (*s == c)
-            p = (char*)s;
+    if (!(char)c)
+        return generic_strchr(s, 0);
+
+    // let strchr skip the bytes between matches
+    while ((s = generic_strchr(s, c))) {
+        p = (char*)s;
+        s++;
+    }
 
     return p;
 }
 
+#ifndef HAVE_ARCH_STRRCHR
+char* strrchr(const char* s, int c) __attribute__((alias("generic_strrchr")));
+#endif
+
+#ifndef HAVE_ARCH_MEMSET
 void* memset(void* s, int c, size_t n) {
     uint8_t* p1 = s;
     uint8_t* p2;
@@ -113,7 +212,9 @@ last:
 
     return s;
 }
+#endif
 
+#ifndef HAVE_ARCH_MEMCPY
 void* memcpy(void* dest, const void* src, size_t n) {
     uint8_t* d = dest;
     const uint8_t* s = src;
@@ -143,7 +244,9 @@ last:
 
     return dest;
 }
+#endif
 
+#ifndef HAVE_ARCH_MEMCMP
 int memcmp(const void* src1, const void* src2, size_t n) {
     const uint8_t* s1 = src1;
     const uint8_t* s2 = src2;
@@ -155,7 +258,9 @@ int memcmp(const void* src1, const void* src2, size_t n) {
 
     return *s1 - *s2;
 }
+#endif
 
+#ifndef HAVE_ARCH_MEMMOVE
 void* memmove(void* dest, const void* src, size_t n) {
     if (dest == src || !n)
         return dest;
@@ -221,17 +326,31 @@ last:
 
     return dest;
 }
+#endif
+
+void* generic_memchr(const void* src, int c, size_t n) {
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned char ch = c;
 
-void* memchr(const void* src, int c, size_t n) {
-    unsigned char* s = (unsigned char*)src;
+    for (; n && !IS_ALIGNED(s); s++, n--)
+        if (*s == ch)
+            return (void*)s;
 
-    for (; n--; s++)
-        if (*s == c)
-            return s;
+    word_t rep = ONES * ch;
+    const word_t* w = (const word_t*)s;
+    for (; n >= WORD_SIZE && !HAS_BYTE(*w, rep); ++w, n -= WORD_SIZE) {}
+
+    for (s = (const unsigned char*)w; n; s++, n--)
+        if (*s == ch)
+            return (void*)s;
 
     return NULL;
 }
 
+#ifndef HAVE_ARCH_MEMCHR
+void* memchr(const void* src, int c, size_t n) __attribute__((alias("generic_memchr")));
+#endif
+
 int internal_strtoull(const char* nptr, char** endptr, int base, int* neg, unsigned long long* v) {
     if (endptr)
         *endptr = (char*)nptr;
@@ -377,13 +496,18 @@ overflow:
 }
 
 char* strstr(const char* haystack, const char* needle) {
-    size_t ln = strlen(needle);
-    if (ln == 0)
+    if (!needle[0])
         return (char*)haystack;
 
-    for (size_t lh = strlen(haystack); lh >= ln; lh--, haystack++) {
-        if (!memcmp(haystack, needle, ln))
-            return (char*)haystack;
+    if (!needle[1])
+        return strchr(haystack, needle[0]);
+
+    // strchr finds the candidates, the end of the haystack is found along the way instead of
+    // computing its length up front
+    size_t ln = strlen(needle);
+    for (const char* h = haystack; (h = strchr(h, needle[0])); ++h) {
+        if (h[1] == needle[1] && !strncmp(h, needle, ln))
+            return (char*)h;
     }
 
     return NULL;
@@ -0,0 +1,74 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * Default allocator used by the containers. Containers only use allocate(), deallocate() and
+ * operator== from the allocator (there is no allocator_traits), so any class providing those can
+ * be used as allocator, see lib.arena for a stateful one.
+ *
+ * An allocator can optionally provide reallocate(), containers of trivially relocatable types use
+ * it to grow their buffer in place when possible.
+ */
+
+module;
+
+#include <stddef.h>
+
+#include <new>
+
+export module std.allocator;
+
+import lib.heap;
+
+export namespace std {
+
+template <typename T>
+struct allocator {
+    using value_type = T;
+
+    constexpr allocator() noexcept = default;
+    template <typename U>
+    constexpr allocator(allocator<U> const&) noexcept {}
+
+    [[nodiscard]] T* allocate(size_t n) {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{alignof(T)}));
+        else
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            ::operator delete(p, std::align_val_t{alignof(T)});
+        else
+            ::operator delete(p);
+    }
+
+    //
+    // reallocate - Resize a buffer from allocate() to @n objects
+    //
+    // The heap grows it in place when the memory after it is free, otherwise the contents are
+    // copied with memcpy. Returns nullptr on failure, @p is still valid in that case
+    //
+    [[nodiscard]] T* reallocate(T* p, size_t, size_t n) noexcept {
+        constexpr size_t align = alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__
+                                     ? alignof(T)
+                                     : __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+        return static_cast<T*>(lib::heap::realloc(p, n * sizeof(T), align));
+    }
+};
+
+template <typename T, typename U>
+constexpr bool operator==(allocator<T> const&, allocator<U> const&) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+constexpr bool operator!=(allocator<T> const&, allocator<U> const&) noexcept {
+    return false;
+}
+
+}  // namespace std
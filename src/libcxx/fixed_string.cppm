@@ -0,0 +1,126 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * fixed_string (extension): string with room for @N chars (plus the null terminator) inside the
+ * object itself, it never allocates. Appending over the capacity truncates the string, append()
+ * tells when that happens.
+ */
+
+module;
+
+#include <stddef.h>
+#include <string.h>
+
+export module std.fixed_string;
+
+export namespace std {
+
+template <size_t N>
+class fixed_string {
+ public:
+    using value_type = char;
+
+    constexpr fixed_string() : len(0) { buf[0] = 0; }
+    fixed_string(char const* s) : fixed_string() { append(s, strlen(s)); }
+
+    //
+    // append - Append @n chars from @s
+    //
+    // Returns false if the string had to be truncated
+    //
+    bool append(char const* s, size_t n) {
+        bool fits = n <= N - len;
+        if (!fits)
+            n = N - len;
+        memcpy(&buf[len], s, n);
+        len += n;
+        buf[len] = 0;
+        return fits;
+    }
+
+    fixed_string& operator+=(char c) {
+        append(&c, 1);
+        return *this;
+    }
+
+    fixed_string& operator+=(char const* s) {
+        append(s, strlen(s));
+        return *this;
+    }
+
+    template <size_t M>
+    fixed_string& operator+=(fixed_string<M> const& s) {
+        append(s.c_str(), s.size());
+        return *this;
+    }
+
+    fixed_string& operator=(char const* s) {
+        clear();
+        append(s, strlen(s));
+        return *this;
+    }
+
+    void clear() {
+        len = 0;
+        buf[0] = 0;
+    }
+
+    char* c_str() { return buf; }
+    char const* c_str() const { return buf; }
+    char* data() { return buf; }
+    char const* data() const { return buf; }
+
+    size_t size() const { return len; }
+    static constexpr size_t capacity() { return N; }
+    bool empty() const { return len == 0; }
+    bool full() const { return len == N; }
+
+    char& operator[](size_t i) { return buf[i]; }
+    char operator[](size_t i) const { return buf[i]; }
+
+    // iterators
+    char* begin() { return buf; }
+    char* end() { return buf + len; }
+    char const* begin() const { return buf; }
+    char const* end() const { return buf + len; }
+
+ private:
+    size_t len;
+    char buf[N + 1];
+};
+
+template <size_t N, size_t M>
+bool operator==(fixed_string<N> const& s1, fixed_string<M> const& s2) {
+    return s1.size() == s2.size() && !memcmp(s1.c_str(), s2.c_str(), s1.size());
+}
+
+template <size_t N, size_t M>
+bool operator!=(fixed_string<N> const& s1, fixed_string<M> const& s2) {
+    return !(s1 == s2);
+}
+
+template <size_t N>
+bool operator==(fixed_string<N> const& str, char const* cstr) {
+    return !strcmp(str.c_str(), cstr);
+}
+
+template <size_t N>
+bool operator!=(fixed_string<N> const& str, char const* cstr) {
+    return !(str == cstr);
+}
+
+template <size_t N>
+bool operator==(char const* cstr, fixed_string<N> const& str) {
+    return str == cstr;
+}
+
+template <size_t N>
+bool operator!=(char const* cstr, fixed_string<N> const& str) {
+    return !(str == cstr);
+}
+
+}  // namespace std
@@ -20,19 +20,24 @@ enum class align_val_t : size_t {};
 
 }
 
-void* operator new(size_t size) {
-    void* ptr = alloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+// @site is the caller of operator new, it is used by the heap tracker to group allocations
+static void* new_impl(size_t size, size_t align, void const* site) {
+    void* ptr = alloc(size, align, site);
     if (!ptr)
         throw exception("new failed", ERR_NO_MEMORY);
     return ptr;
 }
 
+void* operator new(size_t size) {
+    return new_impl(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__, __builtin_return_address(0));
+}
+
 void operator delete(void* p) noexcept {
     free(p);
 }
 
 void* operator new[](size_t size) {
-    return operator new(size);
+    return new_impl(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__, __builtin_return_address(0));
 }
 
 void operator delete[](void* p) noexcept {
@@ -48,14 +53,11 @@ void* operator new[](size_t, void* p) {
 }
 
 void* operator new(size_t size, std::align_val_t align) {
-    void* ptr = alloc(size, static_cast<size_t>(align));
-    if (!ptr)
-        throw exception("new failed", ERR_NO_MEMORY);
-    return ptr;
+    return new_impl(size, static_cast<size_t>(align), __builtin_return_address(0));
 }
 
 void* operator new[](size_t size, std::align_val_t align) {
-    return operator new(size, align);
+    return new_impl(size, static_cast<size_t>(align), __builtin_return_address(0));
 }
 
 void operator delete(void* p, std::align_val_t) noexcept {
@@ -0,0 +1,258 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * small_vector (extension): vector with inline storage for @N objects. Nothing is allocated until
+ * the vector grows over @N, then objects are moved to a buffer from @Alloc (like std::vector) and
+ * the inline storage stays unused.
+ */
+
+module;
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <new>
+
+export module std.small_vector;
+
+export import std.allocator;
+export import std.initializer_list;
+export import std.type_traits;
+
+// placement new prototype
+void* operator new(size_t size, void* ptr);
+
+export namespace std {
+
+template <typename T, size_t N, typename Alloc = allocator<T>>
+class small_vector {
+ public:
+    using value_type = T;
+    using allocator_type = Alloc;
+    using iterator = T*;
+    using const_iterator = T const*;
+    using reference = value_type&;
+
+    small_vector() : s(0), c(N), a(inline_buf()) {}
+    explicit small_vector(Alloc const& alloc) : s(0), c(N), a(inline_buf()), al(alloc) {}
+    small_vector(const std::initializer_list<T>& il, Alloc const& alloc = Alloc())
+        : small_vector(alloc) {
+        reserve(il.size());
+        for (auto& e : il)
+            new (&a[s++]) T(e);
+    }
+    small_vector(const small_vector& vec) : small_vector(vec.al) { copy_from(vec); }
+    small_vector(small_vector&& vec) : small_vector(vec.al) { move_from(vec); }
+    small_vector& operator=(const small_vector& vec) {
+        if (this != &vec) {
+            clear();
+            copy_from(vec);
+        }
+        return *this;
+    }
+    small_vector& operator=(small_vector&& vec) {
+        if (this != &vec) {
+            release();
+            if (al == vec.al)
+                move_from(vec);
+            else
+                copy_from(vec);
+        }
+        return *this;
+    }
+    ~small_vector() { release(); }
+
+    size_t size() const noexcept { return s; }
+    size_t capacity() const noexcept { return c; }
+    [[nodiscard]] bool empty() const noexcept { return s == 0; }
+    Alloc get_allocator() const noexcept { return al; }
+
+    // true while the objects are in the inline storage
+    bool is_inline() const noexcept { return a == inline_buf(); }
+
+    void reserve(size_t n) {
+        if (c >= n)
+            return;
+
+        T* p = al.allocate(n);
+        relocate(p, a, s);
+        if (!is_inline())
+            al.deallocate(a, c);
+        a = p;
+        c = n;
+    }
+
+    void resize(size_t n) {
+        if (n < s) {
+            destroy(&a[n], &a[s]);
+            s = n;
+        } else if (n > s) {
+            reserve(n);
+            while (s < n)
+                new (&a[s++]) T{};
+        }
+    }
+
+    void clear() noexcept {
+        destroy(&a[0], &a[s]);
+        s = 0;
+    }
+
+    void push_back(T const& v) {
+        if (s == c) {
+            // @v could be one of our elements, copy it before growing
+            T tmp(v);
+            grow();
+            new (&a[s++]) T(static_cast<T&&>(tmp));
+            return;
+        }
+        new (&a[s++]) T(v);
+    }
+
+    void push_back(T&& v) {
+        if (s == c) {
+            T tmp(static_cast<T&&>(v));
+            grow();
+            new (&a[s++]) T(static_cast<T&&>(tmp));
+            return;
+        }
+        new (&a[s++]) T(static_cast<T&&>(v));
+    }
+
+    template <typename... Args>
+    reference emplace_back(Args&&... args) {
+        if (s == c)
+            grow();
+        return *new (&a[s++]) T{std::forward<Args>(args)...};
+    }
+
+    void pop_back() {
+        if (s)
+            a[--s].~T();
+    }
+
+    //
+    // erase - Erase one element, following objects are moved one position down
+    //
+    iterator erase(const_iterator pos) {
+        size_t idx = pos - a;
+        if (idx >= s)
+            return end();
+
+        a[idx].~T();
+        relocate(&a[idx], &a[idx + 1], s - idx - 1);
+        s--;
+        return &a[idx];
+    }
+
+    //
+    // insert - Insert @val at @pos
+    //
+    iterator insert(const_iterator pos, T const& val) {
+        size_t idx = pos - a;
+
+        // @val could be one of our elements
+        T tmp(val);
+        if (s == c)
+            grow();
+        if constexpr (is_trivially_relocatable_v<T>) {
+            memmove(static_cast<void*>(&a[idx + 1]), static_cast<void*>(&a[idx]),
+                    (s - idx) * sizeof(T));
+        } else {
+            for (size_t i = s; i-- > idx;) {
+                new (&a[i + 1]) T(static_cast<T&&>(a[i]));
+                a[i].~T();
+            }
+        }
+        new (&a[idx]) T(static_cast<T&&>(tmp));
+        s++;
+        return &a[idx];
+    }
+
+    T* data() noexcept { return a; }
+    T const* data() const noexcept { return a; }
+
+    T& back() { return a[s - 1]; }
+    T const& back() const { return a[s - 1]; }
+
+    // iterators
+    iterator begin() noexcept { return &a[0]; }
+    iterator end() noexcept { return &a[s]; }
+    // const iterators
+    const_iterator begin() const noexcept { return &a[0]; }
+    const_iterator end() const noexcept { return &a[s]; }
+
+    T& operator[](size_t i) { return a[i]; }
+    T const& operator[](size_t i) const { return a[i]; }
+
+ private:
+    static_assert(N > 0, "small_vector needs inline capacity for at least one object");
+
+    size_t s;  // size
+    size_t c;  // capacity
+    T* a;      // inline storage or buffer from the allocator
+    [[no_unique_address]] Alloc al;
+    alignas(T) uint8_t buf[N * sizeof(T)];
+
+    T* inline_buf() noexcept { return reinterpret_cast<T*>(buf); }
+    T const* inline_buf() const noexcept { return reinterpret_cast<T const*>(buf); }
+
+    static void destroy(T* first, T* last) {
+        if constexpr (!is_trivially_destructible_v<T>) {
+            for (; first != last; ++first)
+                first->~T();
+        }
+    }
+
+    // move @n objects from @src to uninitialized @dst, objects at @src are destroyed. @dst must be
+    // below @src or not overlap it
+    static void relocate(T* dst, T* src, size_t n) {
+        if constexpr (is_trivially_relocatable_v<T>) {
+            if (n)
+                memmove(static_cast<void*>(dst), static_cast<void*>(src), n * sizeof(T));
+        } else {
+            for (size_t i = 0; i != n; ++i) {
+                new (&dst[i]) T(static_cast<T&&>(src[i]));
+                src[i].~T();
+            }
+        }
+    }
+
+    void grow() { reserve(c * 2); }
+
+    void release() {
+        clear();
+        if (!is_inline())
+            al.deallocate(a, c);
+        a = inline_buf();
+        c = N;
+    }
+
+    void copy_from(const small_vector& vec) {
+        reserve(vec.s);
+        for (auto& e : vec)
+            new (&a[s++]) T(e);
+    }
+
+    // takes the buffer of @vec, inline objects can only be moved one by one
+    void move_from(small_vector& vec) {
+        if (vec.is_inline()) {
+            relocate(a, vec.a, vec.s);
+            s = vec.s;
+        } else {
+            a = vec.a;
+            s = vec.s;
+            c = vec.c;
+            vec.a = vec.inline_buf();
+            vec.c = N;
+        }
+        vec.s = 0;
+    }
+};
+
+}  // namespace std
@@ -0,0 +1,178 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2022 Fernando Lugo <lugo.fernando@gmail.com>
+ */
+
+/*
+ * static_vector (extension): vector with storage for @N objects inside the object itself, it never
+ * allocates. Operations that would go over the capacity fail instead (push_back() returns false,
+ * emplace_back() returns nullptr), so it can be used from interrupt context or crash paths.
+ */
+
+module;
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <new>
+
+export module std.static_vector;
+
+export import std.initializer_list;
+export import std.type_traits;
+
+// placement new prototype
+void* operator new(size_t size, void* ptr);
+
+export namespace std {
+
+template <typename T, size_t N>
+class static_vector {
+ public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = T const*;
+    using reference = value_type&;
+
+    constexpr static_vector() : s(0) {}
+    static_vector(const std::initializer_list<T>& il) : s(0) {
+        for (auto& e : il)
+            push_back(e);
+    }
+    static_vector(const static_vector& vec) : s(0) {
+        for (auto& e : vec)
+            new (&data()[s++]) T(e);
+    }
+    static_vector(static_vector&& vec) : s(0) {
+        for (auto& e : vec)
+            new (&data()[s++]) T(static_cast<T&&>(e));
+        vec.clear();
+    }
+    static_vector& operator=(const static_vector& vec) {
+        if (this != &vec) {
+            clear();
+            for (auto& e : vec)
+                new (&data()[s++]) T(e);
+        }
+        return *this;
+    }
+    static_vector& operator=(static_vector&& vec) {
+        if (this != &vec) {
+            clear();
+            for (auto& e : vec)
+                new (&data()[s++]) T(static_cast<T&&>(e));
+            vec.clear();
+        }
+        return *this;
+    }
+    ~static_vector() { clear(); }
+
+    constexpr size_t size() const noexcept { return s; }
+    static constexpr size_t capacity() noexcept { return N; }
+    [[nodiscard]] constexpr bool empty() const noexcept { return s == 0; }
+    constexpr bool full() const noexcept { return s == N; }
+
+    //
+    // resize - Change the number of elements, returns false if @n is over the capacity
+    //
+    bool resize(size_t n) {
+        if (n > N)
+            return false;
+
+        while (s > n)
+            data()[--s].~T();
+        while (s < n)
+            new (&data()[s++]) T{};
+        return true;
+    }
+
+    void clear() noexcept {
+        if constexpr (!is_trivially_destructible_v<T>) {
+            for (auto& e : *this)
+                e.~T();
+        }
+        s = 0;
+    }
+
+    //
+    // push_back - Add new object to the end, returns false if the vector is full
+    //
+    bool push_back(T const& v) { return emplace_back(v); }
+    bool push_back(T&& v) { return emplace_back(static_cast<T&&>(v)); }
+
+    //
+    // emplace_back - Construct a new object at the end, returns nullptr if the vector is full
+    //
+    template <typename... Args>
+    T* emplace_back(Args&&... args) {
+        if (full())
+            return nullptr;
+        return new (&data()[s++]) T{std::forward<Args>(args)...};
+    }
+
+    void pop_back() {
+        if (s)
+            data()[--s].~T();
+    }
+
+    //
+    // erase - Erase one element, following objects are moved one position down
+    //
+    iterator erase(const_iterator pos) {
+        auto p = const_cast<iterator>(pos);
+        if (p >= end())
+            return end();
+
+        for (; p + 1 < end(); ++p)
+            *p = static_cast<T&&>(p[1]);
+        data()[--s].~T();
+        return const_cast<iterator>(pos);
+    }
+
+    //
+    // insert - Insert @val at @pos, returns nullptr if the vector is full
+    //
+    iterator insert(const_iterator pos, T const& val) {
+        if (full())
+            return nullptr;
+
+        // @val could be one of our elements
+        T tmp(val);
+        auto p = const_cast<iterator>(pos);
+        if (p == end()) {
+            new (p) T(static_cast<T&&>(tmp));
+        } else {
+            new (end()) T(static_cast<T&&>(end()[-1]));
+            for (auto q = end() - 1; q != p; --q)
+                *q = static_cast<T&&>(q[-1]);
+            *p = static_cast<T&&>(tmp);
+        }
+        s++;
+        return p;
+    }
+
+    constexpr T* data() noexcept { return reinterpret_cast<T*>(buf); }
+    constexpr T const* data() const noexcept { return reinterpret_cast<T const*>(buf); }
+
+    T& back() { return data()[s - 1]; }
+    T const& back() const { return data()[s - 1]; }
+
+    // iterators
+    constexpr iterator begin() noexcept { return data(); }
+    constexpr iterator end() noexcept { return data() + s; }
+    // const iterators
+    constexpr const_iterator begin() const noexcept { return data(); }
+    constexpr const_iterator end() const noexcept { return data() + s; }
+
+    constexpr T& operator[](size_t i) { return data()[i]; }
+    constexpr T const& operator[](size_t i) const { return data()[i]; }
+
+ private:
+    static_assert(N > 0, "static_vector needs capacity for at least one object");
+
+    size_t s;  // size
+    alignas(T) uint8_t buf[N * sizeof(T)];
+};
+
+}  // namespace std
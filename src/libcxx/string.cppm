@@ -6,23 +6,25 @@
 
 module;
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 export module std.string;
 
-import lib.heap;
-
-using lib::heap::alloc;
-using lib::heap::free;
+export import std.allocator;
 
 export namespace std {
 
-template <typename C>
+template <typename C, typename Alloc = allocator<C>>
 class basic_string {
  public:
+    using value_type = C;
+    using allocator_type = Alloc;
+
     basic_string();
-    basic_string(const C* p);
+    explicit basic_string(const Alloc& a);
+    basic_string(const C* p, const Alloc& a = Alloc());
     basic_string(const basic_string&);
     basic_string& operator=(const basic_string&);
     basic_string(basic_string&&);
@@ -40,6 +42,7 @@ class basic_string {
     int size() const { return sz; }
     int capacity() const { return sz <= short_max ? short_max : sz + space; }
     bool empty() const { return sz == 0; }
+    Alloc get_allocator() const { return al; }
 
  private:
     static const int short_max = 15;
@@ -49,6 +52,8 @@ class basic_string {
         int space;
         C ch[short_max + 1];
     };
+    [[no_unique_address]] Alloc al;
+
     static int string_len(const C* s) {
         const C* t = s;
         while (*t)
@@ -59,12 +64,18 @@ class basic_string {
         while ((*dst++ = *src++)) {}
     }
 
-    static C* expand(const C* ptr, int n) {
-        C* p = static_cast<C*>(alloc(sizeof(C) * n, alignof(C)));
+    C* expand(const C* ptr, int n) {
+        C* p = al.allocate(n);
         string_copy(p, ptr);
         return p;
     }
 
+    // long strings buffer holds sz + space chars plus the null terminator
+    void release(C* p, int n) {
+        if (p != ch)
+            al.deallocate(p, n + 1);
+    }
+
     void copy_from(const basic_string& s);
     void move_from(basic_string& s);
 };
@@ -72,10 +83,14 @@ class basic_string {
 //
 // Implementation
 //
-template <typename C>
-void basic_string<C>::copy_from(const basic_string& s) {
+// The allocator is never copied by copy_from()/move_from(), constructors take the allocator of the
+// source string and assignments keep their own one
+//
+template <typename C, typename A>
+void basic_string<C, A>::copy_from(const basic_string& s) {
     if (s.sz <= short_max) {
-        memcpy(this, &s, sizeof(s));
+        memcpy(ch, s.ch, sizeof(ch));
+        sz = s.sz;
         ptr = ch;
     } else {
         ptr = expand(s.ptr, s.sz + 1);
@@ -84,10 +99,11 @@ void basic_string<C>::copy_from(const basic_string& s) {
     }
 }
 
-template <typename C>
-void basic_string<C>::move_from(basic_string& s) {
+template <typename C, typename A>
+void basic_string<C, A>::move_from(basic_string& s) {
     if (s.sz <= short_max) {
-        memcpy(this, &s, sizeof(s));
+        memcpy(ch, s.ch, sizeof(ch));
+        sz = s.sz;
         ptr = ch;
     } else {
         ptr = s.ptr;
@@ -99,51 +115,61 @@ void basic_string<C>::move_from(basic_string& s) {
     }
 }
 
-template <typename C>
-basic_string<C>::basic_string() : sz{0}, ptr{ch} {
+template <typename C, typename A>
+basic_string<C, A>::basic_string() : sz{0}, ptr{ch} {
+    ch[0] = 0;
+}
+
+template <typename C, typename A>
+basic_string<C, A>::basic_string(const A& a) : sz{0}, ptr{ch}, al{a} {
     ch[0] = 0;
 }
 
-template <typename C>
-basic_string<C>::basic_string(const C* p)
-    : sz{string_len(p)},
-      ptr{sz <= short_max ? ch : static_cast<C*>(alloc(sizeof(C) * (sz + 1), alignof(C)))},
-      space{0} {
+template <typename C, typename A>
+basic_string<C, A>::basic_string(const C* p, const A& a) : sz{string_len(p)}, al{a} {
+    ptr = sz <= short_max ? ch : al.allocate(sz + 1);
+    if (ptr != ch)
+        space = 0;
     string_copy(ptr, p);
 }
 
-template <typename C>
-basic_string<C>::basic_string(const basic_string& s) {
+template <typename C, typename A>
+basic_string<C, A>::basic_string(const basic_string& s) : al{s.al} {
     copy_from(s);
 }
 
-template <typename C>
-basic_string<C>::basic_string(basic_string&& s) {
+template <typename C, typename A>
+basic_string<C, A>::basic_string(basic_string&& s) : al{s.al} {
     move_from(s);
 }
 
-template <typename C>
-basic_string<C>& basic_string<C>::operator=(const basic_string& s) {
+template <typename C, typename A>
+basic_string<C, A>& basic_string<C, A>::operator=(const basic_string& s) {
     if (this == &s)
         return *this;
-    C* p = (short_max < sz) ? ptr : nullptr;
+    C* p = ptr;
+    int n = sz + (short_max < sz ? space : 0);
     copy_from(s);
-    free(p);
+    release(p, n);
     return *this;
 }
 
-template <typename C>
-basic_string<C>& basic_string<C>::operator=(basic_string&& s) {
+template <typename C, typename A>
+basic_string<C, A>& basic_string<C, A>::operator=(basic_string&& s) {
     if (this == &s)
         return *this;
     if (short_max < sz)
-        free(ptr);
-    move_from(s);
+        release(ptr, sz + space);
+    // memory can only be stolen if it can be released with our allocator
+    if (al == s.al)
+        move_from(s);
+    else
+        copy_from(s);
     return *this;
 }
 
-template <typename C>
-basic_string<C>& basic_string<C>::operator+=(C c) {
+template <typename C, typename A>
+basic_string<C, A>& basic_string<C, A>::operator+=(C c) {
     if (sz == short_max) {
         int n = sz + sz + 2;
         ptr = expand(ptr, n);
@@ -152,7 +178,7 @@ basic_string<C>& basic_string<C>::operator+=(C c) {
         if (space == 0) {
             int n = sz + sz + 2;
             C* p = expand(ptr, n);
-            free(ptr);
+            release(ptr, sz);
             ptr = p;
             space = n - sz - 2;
         } else {
@@ -165,49 +191,49 @@ basic_string<C>& basic_string<C>::operator+=(C c) {
     return *this;
 }
 
-template <typename C>
-basic_string<C>& basic_string<C>::operator+=(const C* p) {
+template <typename C, typename A>
+basic_string<C, A>& basic_string<C, A>::operator+=(const C* p) {
     for (int i = 0; p[i]; ++p)
         *this += p[i];
     return *this;
 }
 
-template <typename C>
-basic_string<C>::~basic_string() {
+template <typename C, typename A>
+basic_string<C, A>::~basic_string() {
     if (short_max < sz)
-        free(ptr);
+        release(ptr, sz + space);
 }
 
-template <typename C>
-basic_string<C>& operator+=(basic_string<C>& s1, const basic_string<C>& s2) {
+template <typename C, typename A>
+basic_string<C, A>& operator+=(basic_string<C, A>& s1, const basic_string<C, A>& s2) {
     for (auto c : s2)
         s1 += c;
     return s1;
 }
 
-template <typename C>
-basic_string<C> operator+(const basic_string<C>& s1, const basic_string<C>& s2) {
-    basic_string<C> s{s1};
+template <typename C, typename A>
+basic_string<C, A> operator+(const basic_string<C, A>& s1, const basic_string<C, A>& s2) {
+    basic_string<C, A> s{s1};
     s += s2;
     return s;
 }
 
-template <typename C>
-basic_string<C> operator+(const basic_string<C>& s1, const C* p) {
-    basic_string<C> s{s1};
-    s += basic_string<C>(p);
+template <typename C, typename A>
+basic_string<C, A> operator+(const basic_string<C, A>& s1, const C* p) {
+    basic_string<C, A> s{s1};
+    s += p;
     return s;
 }
 
-template <typename C>
-basic_string<C> operator+(const C* p, const basic_string<C>& s1) {
-    basic_string<C> s{p};
+template <typename C, typename A>
+basic_string<C, A> operator+(const C* p, const basic_string<C, A>& s1) {
+    basic_string<C, A> s{p, s1.get_allocator()};
     s += s1;
     return s;
 }
 
-template <typename C>
-bool operator==(const basic_string<C>& s1, const basic_string<C>& s2) {
+template <typename C, typename A1, typename A2>
+bool operator==(const basic_string<C, A1>& s1, const basic_string<C, A2>& s2) {
     if (s1.size() != s2.size())
         return false;
 
@@ -217,54 +243,54 @@ bool operator==(const basic_string<C>& s1, const basic_string<C>& s2) {
     return true;
 }
 
-template <typename C>
-bool operator!=(const basic_string<C>& s1, const basic_string<C>& s2) {
+template <typename C, typename A1, typename A2>
+bool operator!=(const basic_string<C, A1>& s1, const basic_string<C, A2>& s2) {
     return !(s1 == s2);
 }
 
-template <typename C>
-bool operator==(const basic_string<C>& str, const C* cstr) {
+template <typename C, typename A>
+bool operator==(const basic_string<C, A>& str, const C* cstr) {
     const C* tmp = str.c_str();
     for (; *tmp && *tmp == *cstr; ++tmp, ++cstr) {}
 
     return *tmp == *cstr;
 }
 
-template <typename C>
-bool operator!=(const basic_string<C>& str, const C* cstr) {
+template <typename C, typename A>
+bool operator!=(const basic_string<C, A>& str, const C* cstr) {
     return !(str == cstr);
 }
 
-template <typename C>
-bool operator==(const C* cstr, const basic_string<C>& str) {
+template <typename C, typename A>
+bool operator==(const C* cstr, const basic_string<C, A>& str) {
     const C* tmp = str.c_str();
     for (; *tmp && *tmp == *cstr; ++tmp, ++cstr) {}
 
     return *tmp == *cstr;
 }
 
-template <typename C>
-bool operator!=(const C* cstr, const basic_string<C>& str) {
+template <typename C, typename A>
+bool operator!=(const C* cstr, const basic_string<C, A>& str) {
     return !(str == cstr);
 }
 
-template <typename C>
-C* begin(basic_string<C>& s) {
+template <typename C, typename A>
+C* begin(basic_string<C, A>& s) {
     return s.c_str();
 }
 
-template <typename C>
-C* end(basic_string<C>& s) {
+template <typename C, typename A>
+C* end(basic_string<C, A>& s) {
     return s.c_str() + s.size();
 }
 
-template <typename C>
-const C* begin(const basic_string<C>& s) {
+template <typename C, typename A>
+const C* begin(const basic_string<C, A>& s) {
     return s.c_str();
 }
 
-template <typename C>
-const C* end(const basic_string<C>& s) {
+template <typename C, typename A>
+const C* end(const basic_string<C, A>& s) {
     return s.c_str() + s.size();
 }
 
@@ -195,6 +195,15 @@ struct is_function {
 template <class T>
 inline constexpr bool is_function_v = is_function<T>::value;
 
+// type_identity, useful to keep a parameter out of template argument deduction
+template <typename T>
+struct type_identity {
+    using type = T;
+};
+
+template <typename T>
+using type_identity_t = typename type_identity<T>::type;
+
 // add pointer
 namespace detail {
 template <typename T>
@@ -258,6 +267,34 @@ struct is_trivially_constructible {
 template <class T>
 inline constexpr bool is_trivially_constructible_v = is_trivially_constructible<T>::value;
 
+// is_trivially_copyable
+template <typename T>
+struct is_trivially_copyable {
+    static const bool value = __is_trivially_copyable(T);
+};
+
+template <class T>
+inline constexpr bool is_trivially_copyable_v = is_trivially_copyable<T>::value;
+
+// is_trivially_destructible
+template <typename T>
+struct is_trivially_destructible {
+    static const bool value = __has_trivial_destructor(T);
+};
+
+template <class T>
+inline constexpr bool is_trivially_destructible_v = is_trivially_destructible<T>::value;
+
+// is_trivially_relocatable (extension): objects can be moved to a new address with memcpy and
+// the source is not destroyed. Types that don't keep pointers to themselves can specialize it
+template <typename T>
+struct is_trivially_relocatable {
+    static const bool value = __is_trivially_copyable(T);
+};
+
+template <class T>
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
 template <typename T, T v>
 struct integral_constant {
     static constexpr T value = v;
@@ -8,11 +8,13 @@ module;
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <new>
 
 export module std.vector;
 
+export import std.allocator;
 export import std.initializer_list;
 export import std.type_traits;
 
@@ -22,67 +24,76 @@ void* operator new[](size_t size, void* ptr);
 
 export namespace std {
 
-template <typename T>
+template <typename T, typename Alloc = allocator<T>>
 class vector {
  public:
     using value_type = T;
+    using allocator_type = Alloc;
     using iterator = T*;
     using const_iterator = T const*;
     using reference = value_type&;
 
-    constexpr vector() : s(0), c(0), buf(nullptr), a(nullptr) {}
-    constexpr vector(const std::initializer_list<T>& il) : vector() {
-        reserve(il.size());
-        for (auto&& t : il)
-            push_back(t);
+    constexpr vector() : s(0), c(0), a(nullptr) {}
+    constexpr explicit vector(Alloc const& alloc) : s(0), c(0), a(nullptr), al(alloc) {}
+    constexpr vector(const std::initializer_list<T>& il, Alloc const& alloc = Alloc())
+        : vector(alloc) {
+        assign(il.begin(), il.end());
     }
-    constexpr vector(const vector& vec) : vector() {
-        for (auto& e : vec)
-            push_back(e);
+    // the copy uses the same allocator as @vec
+    constexpr vector(const vector& vec) : vector(vec.al) { assign(vec.begin(), vec.end()); }
+    constexpr vector(vector&& vec) : s(vec.s), c(vec.c), a(vec.a), al(vec.al) {
+        vec.s = 0;
+        vec.c = 0;
+        vec.a = nullptr;
     }
     constexpr vector& operator=(const vector& vec) {
-        resize(0);
-        for (const auto& e : vec)
-            push_back(e);
+        if (this != &vec)
+            assign(vec.begin(), vec.end());
         return *this;
     }
-    constexpr vector& operator=(const std::initializer_list<T>& il) {
-        // call destructor for all objects
-        for (auto p = a; p != &a[s]; ++p)
-            p->~T();
-        s = 0;
-        reserve(il.size());
-        for (auto&& t : il)
-            push_back(t);
+    constexpr vector& operator=(vector&& vec) {
+        if (this == &vec)
+            return *this;
+        // buffers can only be stolen if they can be released by our allocator
+        if (al != vec.al) {
+            assign(vec.begin(), vec.end());
+            return *this;
+        }
+        release();
+        s = vec.s;
+        c = vec.c;
+        a = vec.a;
+        vec.s = 0;
+        vec.c = 0;
+        vec.a = nullptr;
         return *this;
     }
-    constexpr ~vector() {
-        // call destructor for all objects
-        for (auto p = a; p != &a[s]; ++p)
-            p->~T();
-        delete[] buf;  // delete memory
+    constexpr vector& operator=(const std::initializer_list<T>& il) {
+        assign(il.begin(), il.end());
+        return *this;
     }
+    constexpr ~vector() { release(); }
     constexpr size_t capacity() const noexcept { return c; }
     constexpr size_t size() const noexcept { return s; }
+    constexpr Alloc get_allocator() const noexcept { return al; }
 
     constexpr void reserve(size_t n) {
-        if (c < n) {
-            c = n;
-            align_u8* tmp_buf = new align_u8[c];
-            T* p = reinterpret_cast<T*>(tmp_buf);
-
-            // copy objects to new location
-            for (size_t i = 0; i != s; ++i)
-                new (&p[i]) T(a[i]);
-            // destroy previous objects
-            for (size_t i = 0; i != s; ++i)
-                a[i].~T();
+        if (c < n)
+            realloc_buffer(n);
+    }
 
-            delete[] buf;  // delete old buffer
+    //
+    // shrink_to_fit - Reduce capacity to the current size
+    //
+    constexpr void shrink_to_fit() {
+        if (s == c)
+            return;
 
-            a = p;
-            buf = tmp_buf;
+        if (!s) {
+            release();
+            return;
         }
+        realloc_buffer(s);
     }
 
     constexpr void resize(size_t n) {
@@ -90,8 +101,7 @@ class vector {
             return;
 
         if (n < s) {
-            for (auto p = &a[n]; p != &a[s]; ++p)
-                p->~T();
+            destroy(&a[n], &a[s]);
             s = n;
         } else if (n > s) {
             reserve(n);
@@ -101,17 +111,47 @@ class vector {
     }
 
     constexpr void clear() noexcept {
-        // call destructor for all objects
-        for (auto p = a; p != &a[s]; ++p)
-            p->~T();
+        destroy(&a[0], &a[s]);
         s = 0;
     }
 
+    //
+    // assign - Replace the contents with the elements in [@first, @last)
+    //
+    template <typename It>
+        requires(!is_integral_v<It>)
+    constexpr void assign(It first, It last) {
+        clear();
+        reserve(distance(first, last));
+        for (; first != last; ++first)
+            new (&a[s++]) T(*first);
+    }
+
+    //
+    // assign - Replace the contents with @n copies of @val
+    //
+    constexpr void assign(size_t n, T const& val) {
+        // @val could be one of our elements
+        T tmp(val);
+        clear();
+        reserve(n);
+        while (s < n)
+            new (&a[s++]) T(tmp);
+    }
+
+    constexpr void assign(const std::initializer_list<T>& il) { assign(il.begin(), il.end()); }
+
     //
     // push_back - Add new object to the end
     //
     constexpr void push_back(T const& v) {
-        alloc_for_size(s + 1);
+        if (s == c) {
+            // @v could be one of our elements, copy it before growing
+            T tmp(v);
+            alloc_for_size(s + 1);
+            new (&a[s++]) T{static_cast<T&&>(tmp)};
+            return;
+        }
         new (&a[s++]) T{v};
     }
 
@@ -119,7 +159,12 @@ class vector {
     // push_back - Add new object to the end (rvalue)
     //
     constexpr void push_back(T&& v) {
-        alloc_for_size(s + 1);
+        if (s == c) {
+            T tmp(static_cast<T&&>(v));
+            alloc_for_size(s + 1);
+            new (&a[s++]) T{static_cast<T&&>(tmp)};
+            return;
+        }
         new (&a[s++]) T{static_cast<T&&>(v)};
     }
 
@@ -138,12 +183,21 @@ class vector {
     constexpr iterator erase(const_iterator pos) {
         if (pos >= end())
             return end();
+        return erase(pos, pos + 1);
+    }
 
-        for (iterator p = const_cast<iterator>(pos) + 1; p < end(); ++p)
-            *(p - 1) = std::move(*p);
-        pos->~T();
-        s--;
-        return const_cast<iterator>(pos);
+    //
+    // erase - Erase elements in [@first, @last)
+    //
+    constexpr iterator erase(const_iterator first, const_iterator last) {
+        size_t idx = first - a;
+        size_t n = last - first;
+        if (!n)
+            return &a[idx];
+
+        destroy(&a[idx], &a[idx + n]);
+        close_gap(idx, n);
+        return &a[idx];
     }
 
     //
@@ -152,15 +206,7 @@ class vector {
     // @pos     Iterator (position) where the new element will be inserted
     // @val     New T object
     //
-    constexpr iterator insert(const_iterator pos, T const& val) {
-        alloc_for_size(s + 1);
-        for (iterator p = end(); p != pos; --p)
-            *p = std::move(p[-1]);
-        s++;
-        iterator p = const_cast<iterator>(pos);
-        new (p) T{val};
-        return p;
-    }
+    constexpr iterator insert(const_iterator pos, T const& val) { return emplace(pos, val); }
 
     //
     // insert - Insert new T object (rvalue)
@@ -169,24 +215,80 @@ class vector {
     // @val     New T object
     //
     constexpr iterator insert(const_iterator pos, T&& val) {
-        alloc_for_size(s + 1);
-        for (iterator p = end(); p != pos; --p)
-            *p = std::move(*(p - 1));
-        s++;
-        iterator p = const_cast<iterator>(pos);
-        new (p) T{std::move(val)};
-        return p;
+        return emplace(pos, static_cast<T&&>(val));
+    }
+
+    //
+    // insert - Insert @n copies of @val at @pos
+    //
+    constexpr iterator insert(const_iterator pos, size_t n, T const& val) {
+        size_t idx = pos - a;
+        if (!n)
+            return &a[idx];
+
+        T tmp(val);
+        open_gap(idx, n);
+        size_t i = 0;
+        try {
+            for (; i != n; ++i)
+                new (&a[idx + i]) T(tmp);
+        } catch (...) {
+            undo_gap(idx, n, i);
+            throw;
+        }
+        s += n;
+        return &a[idx];
+    }
+
+    //
+    // insert - Insert the elements in [@first, @last) at @pos
+    //
+    // The range must not point into this vector
+    //
+    template <typename It>
+        requires(!is_integral_v<It>)
+    constexpr iterator insert(const_iterator pos, It first, It last) {
+        size_t idx = pos - a;
+        size_t n = distance(first, last);
+        if (!n)
+            return &a[idx];
+
+        open_gap(idx, n);
+        size_t i = 0;
+        try {
+            for (; first != last; ++first, ++i)
+                new (&a[idx + i]) T(*first);
+        } catch (...) {
+            undo_gap(idx, n, i);
+            throw;
+        }
+        s += n;
+        return &a[idx];
+    }
+
+    constexpr iterator insert(const_iterator pos, const std::initializer_list<T>& il) {
+        return insert(pos, il.begin(), il.end());
     }
 
     template <typename... Args>
     constexpr iterator emplace(const_iterator pos, Args&&... args) {
-        alloc_for_size(s + 1);
-        for (iterator p = end(); p != pos; --p)
-            *p = std::move(*(p - 1));
+        size_t idx = pos - a;
+        if (idx == s) {
+            emplace_back(std::forward<Args>(args)...);
+            return &a[idx];
+        }
+
+        // construct it first, the arguments could refer to our elements
+        T tmp{std::forward<Args>(args)...};
+        open_gap(idx, 1);
+        try {
+            new (&a[idx]) T{static_cast<T&&>(tmp)};
+        } catch (...) {
+            undo_gap(idx, 1, 0);
+            throw;
+        }
         s++;
-        iterator p = const_cast<iterator>(pos);
-        new (p) T{std::forward<Args>(args)...};
-        return p;
+        return &a[idx];
     }
 
     //
@@ -208,18 +310,108 @@ class vector {
     constexpr T const& operator[](size_t i) const { return a[i]; }
 
  private:
-    // create a new type which is compliant with T alignment
-    struct alignas(T) align_u8 {
-        uint8_t bytes[sizeof(T)];
-    };
-
     // capacity when inserting the first element, since most likely we will keep inserting more
     static constexpr size_t INITIAL_CAP = 4;
 
-    size_t s;       // size
-    size_t c;       // capacity
-    align_u8* buf;  // raw memory
-    T* a;           // Array of T objects
+    // objects can be moved around with memcpy/memmove
+    static constexpr bool relocatable = is_trivially_relocatable_v<T>;
+
+    size_t s;  // size
+    size_t c;  // capacity
+    T* a;      // Array of T objects (raw memory comes from the allocator)
+    [[no_unique_address]] Alloc al;
+
+    template <typename It>
+    static constexpr size_t distance(It first, It last) {
+        if constexpr (is_pointer_v<It>) {
+            return last - first;
+        } else {
+            size_t n = 0;
+            for (; first != last; ++first)
+                n++;
+            return n;
+        }
+    }
+
+    static constexpr void destroy(T* first, T* last) {
+        if constexpr (!is_trivially_destructible_v<T>) {
+            for (; first != last; ++first)
+                first->~T();
+        }
+    }
+
+    // move @n objects from @src to uninitialized @dst, objects at @src are destroyed. @dst must be
+    // below @src or not overlap it
+    static constexpr void relocate(T* dst, T* src, size_t n) {
+        if constexpr (relocatable) {
+            if (n)
+                memmove(static_cast<void*>(dst), static_cast<void*>(src), n * sizeof(T));
+        } else {
+            for (size_t i = 0; i != n; ++i) {
+                new (&dst[i]) T(static_cast<T&&>(src[i]));
+                src[i].~T();
+            }
+        }
+    }
+
+    void release() {
+        destroy(&a[0], &a[s]);
+        if (a)
+            al.deallocate(a, c);
+        s = 0;
+        c = 0;
+        a = nullptr;
+    }
+
+    // change capacity to @n (>= size), objects are moved to the new buffer
+    void realloc_buffer(size_t n) {
+        if constexpr (relocatable && requires(Alloc& x, T* p) { x.reallocate(p, n, n); }) {
+            if (a) {
+                if (T* p = al.reallocate(a, c, n)) {
+                    a = p;
+                    c = n;
+                    return;
+                }
+            }
+        }
+
+        T* p = al.allocate(n);
+        relocate(p, a, s);
+        if (a)
+            al.deallocate(a, c);
+
+        a = p;
+        c = n;
+    }
+
+    // make room for @n objects at @idx, on return [@idx, @idx + @n) is uninitialized memory. The
+    // size is not updated, the caller adds @n once the objects in the gap are constructed
+    void open_gap(size_t idx, size_t n) {
+        alloc_for_size(s + n);
+        if constexpr (relocatable) {
+            if (idx != s)
+                memmove(static_cast<void*>(&a[idx + n]), static_cast<void*>(&a[idx]),
+                        (s - idx) * sizeof(T));
+        } else {
+            // from the end, so every destination was already moved (or was never constructed)
+            for (size_t i = s; i-- > idx;) {
+                new (&a[i + n]) T(static_cast<T&&>(a[i]));
+                a[i].~T();
+            }
+        }
+    }
+
+    // undo open_gap() when constructing the objects in it failed, only the first @done were built
+    void undo_gap(size_t idx, size_t n, size_t done) {
+        destroy(&a[idx], &a[idx + done]);
+        relocate(&a[idx], &a[idx + n], s - idx);
+    }
+
+    // remove the uninitialized gap of @n objects at @idx
+    void close_gap(size_t idx, size_t n) {
+        relocate(&a[idx], &a[idx + n], s - idx - n);
+        s -= n;
+    }
 
     //
     // alloc_for_size - make sure we have capacity for new size
@@ -239,6 +431,4 @@ class vector {
     }
 };
 
-// TODO: Implement optimized version for standard layout types
-
 }  // namespace std
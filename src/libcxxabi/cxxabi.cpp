@@ -4,11 +4,22 @@
  * Copyright (C) 2021 Fernando Lugo <lugo.fernando@gmail.com>
  */
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unwind.h>
 
+import lib.pool;
+
+#ifndef CONFIG_CXXABI_EXCEPTION_SLOTS
+#define CONFIG_CXXABI_EXCEPTION_SLOTS 16
+#endif
+
+#ifndef CONFIG_CXXABI_EXCEPTION_SLOT_SIZE
+#define CONFIG_CXXABI_EXCEPTION_SLOT_SIZE 256
+#endif
+
 namespace __cxxabiv1 {
 
 // type info structs
@@ -36,24 +47,6 @@ namespace std {
 }
 }  // namespace std
 
-static _Unwind_Exception* curr_excep;
-
-extern "C" void* __cxa_begin_catch(void* exceptionObject) {
-    _Unwind_Exception* ue = static_cast<_Unwind_Exception*>(exceptionObject);
-    curr_excep = ue;
-    return ue + 1;
-}
-
-extern "C" void __cxa_end_catch() {
-    curr_excep = nullptr;
-}
-
-extern "C" void __cxa_rethrow() {
-    if (curr_excep)
-        _Unwind_RaiseException(curr_excep);
-    std::terminate();
-}
-
 extern "C" int __cxa_atexit(void (*)(void*), void*, void*) {
     return 0;
 }
@@ -69,21 +62,110 @@ extern "C" int __cxa_guard_acquire(int*) {
 extern "C" void __cxa_guard_release(int*) {}
 
 struct __cxa_exception {
+    void (*exceptionDestructor)(void*);
+    __cxa_exception* nextException;  // next in the caught exceptions stack
+    int handlerCount;                // number of handlers using it, negative if rethrown
     struct type_info* exceptionType;
-    _Unwind_Exception unwindHeader;
+    _Unwind_Exception unwindHeader;  // it must be the last member, thrown object follows it
+};
+
+// per thread exception handling state
+struct __cxa_eh_globals {
+    __cxa_exception* caughtExceptions;
+    unsigned uncaughtExceptions;
+};
+
+// The thread library provides the state of the current thread, this one is only used when there is
+// no thread support
+extern "C" [[gnu::weak]] void* __cxa_get_globals() {
+    static __cxa_eh_globals globals;
+    return &globals;
+}
+
+static __cxa_eh_globals* get_globals() {
+    return static_cast<__cxa_eh_globals*>(__cxa_get_globals());
+}
+
+static __cxa_exception* get_header(void* thrown_exception) {
+    return static_cast<__cxa_exception*>(thrown_exception) - 1;
+}
+
+// Exceptions are allocated from this pool first so that a throw does not need to take the heap lock
+// and it still works when the heap is exhausted (e.g. operator new throwing). Big exceptions or
+// running out of slots falls back to malloc
+struct alignas(__cxa_exception) exception_slot {
+    uint8_t mem[CONFIG_CXXABI_EXCEPTION_SLOT_SIZE];
 };
 
+static lib::pool<exception_slot, CONFIG_CXXABI_EXCEPTION_SLOTS> exception_pool;
+
 extern "C" void* __cxa_allocate_exception(size_t size) {
     size_t total = sizeof(__cxa_exception) + size;
-    void* ptr = malloc(total);
-    memset(ptr, 0, size);
-    ptr = ((__cxa_exception*)ptr + 1);
-    return ptr;
+    void* ptr = total <= sizeof(exception_slot) ? exception_pool.alloc() : nullptr;
+    if (!ptr)
+        ptr = malloc(total);
+    if (!ptr) {
+        printf("no memory for exception of size %zu\n", size);
+        std::terminate();
+    }
+    memset(ptr, 0, total);
+    return static_cast<__cxa_exception*>(ptr) + 1;
 }
 
 extern "C" void __cxa_free_exception(void* thrown_exception) {
-    __cxa_exception* header = ((__cxa_exception*)thrown_exception - 1);
-    free(header);
+    __cxa_exception* header = get_header(thrown_exception);
+    if (exception_pool.owns(header))
+        exception_pool.free(header);
+    else
+        free(header);
+}
+
+extern "C" void* __cxa_begin_catch(void* exceptionObject) {
+    auto ue = static_cast<_Unwind_Exception*>(exceptionObject);
+    void* thrown_exception = ue + 1;
+    __cxa_exception* header = get_header(thrown_exception);
+    __cxa_eh_globals* globals = get_globals();
+
+    header->handlerCount = header->handlerCount < 0 ? -header->handlerCount + 1
+                                                    : header->handlerCount + 1;
+    if (header != globals->caughtExceptions) {
+        header->nextException = globals->caughtExceptions;
+        globals->caughtExceptions = header;
+    }
+    globals->uncaughtExceptions--;
+    return thrown_exception;
+}
+
+extern "C" void __cxa_end_catch() {
+    __cxa_eh_globals* globals = get_globals();
+    __cxa_exception* header = globals->caughtExceptions;
+    if (!header)
+        return;
+
+    if (header->handlerCount < 0) {
+        // rethrown, it is still alive, just remove it from the caught stack
+        if (++header->handlerCount == 0)
+            globals->caughtExceptions = header->nextException;
+    } else if (--header->handlerCount == 0) {
+        globals->caughtExceptions = header->nextException;
+        if (header->exceptionDestructor)
+            header->exceptionDestructor(header + 1);
+        __cxa_free_exception(header + 1);
+    }
+}
+
+extern "C" void __cxa_rethrow() {
+    __cxa_eh_globals* globals = get_globals();
+    __cxa_exception* header = globals->caughtExceptions;
+    if (!header)
+        std::terminate();
+
+    header->handlerCount = -header->handlerCount;
+    globals->uncaughtExceptions++;
+    _Unwind_RaiseException(&header->unwindHeader);
+
+    // no handler found
+    std::terminate();
 }
 
 extern "C" void __cxa_end_cleanup(void) {
@@ -91,10 +173,13 @@ extern "C" void __cxa_end_cleanup(void) {
 
 static const uint64_t EXCEPTION_CLASS_CLANG = 0x434C4E47432B2B00;
 
-extern "C" void __cxa_throw(void* thrown_exception, struct type_info* tinfo, void (*)(void*)) {
-    __cxa_exception* header = ((__cxa_exception*)thrown_exception - 1);
+extern "C" void __cxa_throw(void* thrown_exception, struct type_info* tinfo,
+                            void (*dest)(void*)) {
+    __cxa_exception* header = get_header(thrown_exception);
     header->exceptionType = tinfo;
+    header->exceptionDestructor = dest;
     header->unwindHeader.exception_class = EXCEPTION_CLASS_CLANG;
+    get_globals()->uncaughtExceptions++;
     _Unwind_Reason_Code code = _Unwind_RaiseException(&header->unwindHeader);
 
     // __cxa_throw never returns
@@ -6,6 +6,7 @@
 
 module;
 
+#include <stddef.h>
 #include <stdint.h>
 
 export module soc.rp2040.bootrom;
@@ -36,6 +37,19 @@ enum {
 
 static void* rom_funcs[FUNC_MAX];
 
+extern "C" void* __memcpy_armv6m(void* dest, void const* src, size_t n);
+extern "C" void* __memset_armv6m(void* s, int c, size_t n);
+
+using memcpy_t = void* (*)(void* dest, void const* src, size_t n);
+using memset_t = void* (*)(void* s, int c, size_t n);
+
+// memory functions are used before init(), so they start with the generic versions. The *4 ones
+// need word aligned pointers and a size multiple of 4
+static memcpy_t rom_memcpy = __memcpy_armv6m;
+static memcpy_t rom_memcpy4 = __memcpy_armv6m;
+static memset_t rom_memset = __memset_armv6m;
+static memset_t rom_memset4 = __memset_armv6m;
+
 export namespace soc::rp2040::bootrom {
 
 extern "C" {
@@ -65,12 +79,33 @@ int __ctzsi2(unsigned) {
     )" :: "r"(&rom_funcs[CTZ32]) : "r0");
 }
 // clang-format on
+
+void* memcpy(void* dest, void const* src, size_t n) {
+    if ((reinterpret_cast<uintptr_t>(dest) | reinterpret_cast<uintptr_t>(src) | n) & 3)
+        return rom_memcpy(dest, src, n);
+    return rom_memcpy4(dest, src, n);
+}
+
+void* memset(void* s, int c, size_t n) {
+    if ((reinterpret_cast<uintptr_t>(s) | n) & 3)
+        return rom_memset(s, c, n);
+    return rom_memset4(s, c, n);
+}
 }
 
 void init() {
     rom_funcs[POPCOUNT32] = rom_func_lookup(rom_table_code('P', '3'));
     rom_funcs[CLZ32] = rom_func_lookup(rom_table_code('L', '3'));
     rom_funcs[CTZ32] = rom_func_lookup(rom_table_code('T', '3'));
+
+    if (auto f = rom_func_lookup(rom_table_code('M', 'C')))
+        rom_memcpy = reinterpret_cast<memcpy_t>(f);
+    if (auto f = rom_func_lookup(rom_table_code('C', '4')))
+        rom_memcpy4 = reinterpret_cast<memcpy_t>(f);
+    if (auto f = rom_func_lookup(rom_table_code('M', 'S')))
+        rom_memset = reinterpret_cast<memset_t>(f);
+    if (auto f = rom_func_lookup(rom_table_code('S', '4')))
+        rom_memset4 = reinterpret_cast<memset_t>(f);
 }
 
 }  // namespace soc::rp2040::bootrom
@@ -93,7 +93,7 @@ io_ctrl& get_io_ctrl(unsigned gpio) {
 
 export namespace soc::rp2040 {
 
-class gpio : public device::gpio {
+class gpio final : public device::gpio {
  public:
     gpio(std::string const& name, unsigned irq) : ::device::gpio(name), irq(irq) {
         callbacks.resize(MAX_GPIO_NUM + 1);
@@ -41,7 +41,7 @@ enum regs : uint32_t {
 
 export namespace soc::rp2040 {
 
-class i2c : public device::i2c {
+class i2c final : public device::i2c {
  public:
     struct platform_data {
         unsigned base;
@@ -14,9 +14,8 @@ import soc.rp2040.mailbox;
 
 using lib::reg::reg32;
 
-// TODO: make it configurable
-constexpr uintptr_t CORE1_STACK_START = 0x20041000;
-constexpr size_t CORE1_STACK_SIZE = 0x1000;
+// core1 stack is in scratch Y bank, see linker script
+extern "C" uint8_t __core1_stack_end[];
 
 namespace {
 
@@ -30,7 +29,7 @@ enum {
 export namespace soc::rp2040::multicore {
 
 void core1_start(void (*entry)()) {
-    uintptr_t stack = CORE1_STACK_START + CORE1_STACK_SIZE;
+    uintptr_t stack = reinterpret_cast<uintptr_t>(__core1_stack_end);
     uintptr_t vtor = reg32(0xe0000000 + 0xed08);
 
     uintptr_t seq[] = {
@@ -126,7 +126,7 @@ io_ctrl& get_io_ctrl(unsigned pwm) {
 
 export namespace soc::rp2040 {
 
-class pwm : public device::pwm {
+class pwm final : public device::pwm {
  public:
     pwm(std::string const& name, unsigned gpio) : ::device::pwm(name), gpio(gpio), p(0), dc(0) {}
 
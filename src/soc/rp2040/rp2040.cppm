@@ -16,6 +16,7 @@ import soc.rp2040.hwspinlock;
 import soc.rp2040.mailbox;
 import soc.rp2040.bootrom;
 import soc.rp2040.rtc;
+import lib.heap;
 import lib.reg;
 
 #define RESET      (soc::rp2040::address_map::RESETS_BASE + 0x00)
@@ -23,6 +24,9 @@ import lib.reg;
 
 using lib::reg::reg32;
 
+extern "C" uint8_t __scratch_x_start[];
+extern "C" uint8_t __scratch_x_end[];
+
 volatile uint32_t& reg_clr(uintptr_t addr) {
     return reg32(addr + 0x3000);
 }
@@ -132,6 +136,11 @@ void init() {
     hwspinlock::init();
     mailbox::init();
     rtc::init();
+
+    // core0 gets scratch X for its stacks and hot data, core1 stack already lives in scratch Y, so
+    // each core has a bank that is never accessed by the other one
+    lib::heap::add_region("scratch_x", __scratch_x_start, __scratch_x_end,
+                          lib::heap::REGION_CORE_LOCAL, 0);
 }
 
 }  // namespace soc::rp2040
@@ -40,7 +40,7 @@ enum regs : uint32_t {
 
 export namespace soc::rp2040 {
 
-class spi : public device::spi {
+class spi final : public device::spi {
  public:
     struct platform_data {
         uintptr_t base;
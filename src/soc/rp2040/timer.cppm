@@ -63,7 +63,7 @@ struct event_impl : public timer::event {
 
 export namespace device {
 
-class timer_rp2040 : public timer {
+class timer_rp2040 final : public timer {
  public:
     struct platform_data {
         uintptr_t base;